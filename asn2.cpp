@@ -269,7 +269,7 @@ public:
         u = BigInteger::makeProbablePrime(bitCount);
         v = BigInteger::makeProbablePrime(bitCount);
         n = u * v;
-        BigInteger phi = (u - BigInteger(1)) * (v - BigInteger(1));
+        BigInteger phi = (u - 1) * (v - 1);
         e = BigInteger(65537);
         d = e.modularInverse(phi);
     }
@@ -370,7 +370,7 @@ void testRSA()
     v = BigInteger::makeProbablePrime(bits);
     cout << "v = " << v << endl;
     BigInteger n = u * v;
-    BigInteger phi = (u - BigInteger(1)) * (v - BigInteger(1));
+    BigInteger phi = (u - 1) * (v - 1);
     cout << "n = " << n << endl;
     cout << "phi = " << phi << endl;
     BigInteger e = BigInteger(65537);
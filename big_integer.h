@@ -9,6 +9,14 @@
 #include <stdexcept>
 #include <cstring>
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <type_traits>
+#if __cplusplus > 201703L && defined(__cpp_impl_three_way_comparison)
+#include <compare>
+#define BIG_INTEGER_HAS_THREE_WAY_COMPARISON
+#endif
+#include "big_integer_kernels.h"
 
 using namespace std;
 
@@ -87,36 +95,455 @@ inline int log2(uint64_t v)
 }
 #endif
 
-inline int randomDigit(int base, bool useSecureRandom = false)
+#ifndef __GNUC__ // portable method
+inline int popcount(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    v = (v + (v >> 4)) & 0x0F0F0F0F;
+    return static_cast<int>((v * 0x01010101) >> 24);
+}
+
+inline int countTrailingZeros(uint32_t v)
+{
+    return log2(v & -v);
+}
+#else // fast GCC specific method
+inline int popcount(uint32_t v)
+{
+    return __builtin_popcountl(v);
+}
+
+inline int countTrailingZeros(uint32_t v)
+{
+    return __builtin_ctzl(v);
+}
+#endif
+
+// the random state of each thread : a 64 bit engine seeded from the clock and the address of the state, so threads
+// started in the same second still differ, and the random device, opened on the first secure request
+class ThreadRandomState
+{
+private:
+    mt19937_64 engine;
+    random_device * device;
+    bool didOpenDevice;
+    ThreadRandomState()
+        : device(NULL), didOpenDevice(false)
+    {
+        uint64_t t = static_cast<uint64_t>(time(NULL));
+        uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this));
+        seed_seq seed{static_cast<uint32_t>(t), static_cast<uint32_t>(t >> 32),
+                      static_cast<uint32_t>(address), static_cast<uint32_t>(address >> 32)};
+        engine.seed(seed);
+    }
+    ThreadRandomState(const ThreadRandomState &);
+    const ThreadRandomState & operator =(const ThreadRandomState &);
+public:
+    ~ThreadRandomState()
+    {
+        delete device;
+    }
+    static ThreadRandomState & get()
+    {
+        thread_local ThreadRandomState state;
+        return state;
+    }
+    mt19937_64 & getEngine()
+    {
+        return engine;
+    }
+    // NULL when there is no random device
+    random_device * getDevice()
+    {
+        if(!didOpenDevice)
+        {
+            didOpenDevice = true;
+            try
+            {
+                device = new random_device;
+            }
+            catch(exception & e)
+            {
+                device = NULL;
+            }
+        }
+        return device;
+    }
+};
+
+// fills limbs with secure random words
+typedef void (*SecureRandomSource)(uint32_t * limbs, size_t count);
+
+// the source read when useSecureRandom is set; NULL, the default, reads the random device of the thread.
+// the source is shared by every thread, so set it before other threads make random numbers
+inline SecureRandomSource & secureRandomSource()
 {
-    static random_device * theRandomDevice = NULL;
-    static default_random_engine theDefaultRandomEngine;
-    static bool didInitDefaultRandomEngine = false;
-    if(!didInitDefaultRandomEngine)
+    static SecureRandomSource source = NULL;
+    return source;
+}
+
+// the installed secure source as a uniform random bit generator for the standard distributions
+struct SecureRandomWords
+{
+    typedef uint32_t result_type;
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+    static constexpr result_type max()
+    {
+        return 0xFFFFFFFFU;
+    }
+    result_type operator ()() const
     {
-        didInitDefaultRandomEngine = true;
-        theDefaultRandomEngine.seed(time(NULL));
+        uint32_t retval;
+        secureRandomSource()(&retval, 1);
+        return retval;
     }
+};
+
+inline int randomDigit(int base, bool useSecureRandom = false)
+{
+    ThreadRandomState & state = ThreadRandomState::get();
     uniform_int_distribution<int> d(0, base - 1);
-    if(!useSecureRandom)
-        return d(theDefaultRandomEngine);
-    try
+    if(useSecureRandom && secureRandomSource() != NULL)
     {
-        if(theRandomDevice == NULL)
+        SecureRandomWords words;
+        return d(words);
+    }
+    random_device * device = useSecureRandom ? state.getDevice() : NULL;
+    if(device != NULL)
+        return d(*device);
+    return d(state.getEngine());
+}
+
+// fills limbs with uniform random words : two limbs per call of the thread's 64 bit engine, or when useSecureRandom
+// is set, from the installed secure source or one per call of the random device if there is one
+inline void randomLimbs(uint32_t * limbs, size_t count, bool useSecureRandom = false)
+{
+    if(useSecureRandom && secureRandomSource() != NULL)
+    {
+        secureRandomSource()(limbs, count);
+        return;
+    }
+    ThreadRandomState & state = ThreadRandomState::get();
+    random_device * device = useSecureRandom ? state.getDevice() : NULL;
+    if(device != NULL)
+    {
+        uniform_int_distribution<uint32_t> d;
+        for(size_t i = 0; i < count; i++)
         {
-            theRandomDevice = new random_device;
-            atexit([](){delete theRandomDevice;});
+            limbs[i] = d(*device);
         }
-        return d(*theRandomDevice);
+        return;
+    }
+    mt19937_64 & engine = state.getEngine();
+    size_t i = 0;
+    for(; i + 1 < count; i += 2)
+    {
+        uint64_t v = engine();
+        limbs[i] = static_cast<uint32_t>(v);
+        limbs[i + 1] = static_cast<uint32_t>(v >> 32);
     }
-    catch(exception * e)
+    if(i < count)
     {
-        return d(theDefaultRandomEngine);
+        limbs[i] = static_cast<uint32_t>(engine());
     }
 }
 
+// true for the built in integer types that fit in 64 bits; these get overloads that skip building a temporary BigInteger
+template <typename T>
+struct isNativeInteger
+{
+    static const bool value = is_integral<T>::value && !is_same<T, bool>::value && sizeof(T) <= sizeof(uint64_t);
+};
+
+// the direction divMod rounds the quotient in
+enum class Rounding
+{
+    Truncate,
+    Floor,
+    Ceiling
+};
+
+class BigInteger;
+template <typename Derived>
+class BigIntegerExpression;
+struct BigIntegerExpressionAccess;
+
+// a read only window onto limbs owned by someone else; it must not outlive them
+class BigIntegerView
+{
+    friend class BigInteger;
+private:
+    const uint32_t * digits;
+    size_t size;
+    bool isNegative;
+public:
+    BigIntegerView(const uint32_t * digits, size_t size, bool isNegative)
+        : digits(digits), size(size), isNegative(isNegative)
+    {
+        while(this->size > 0 && digits[this->size - 1] == 0)
+        {
+            this->size--;
+        }
+        if(this->size == 0)
+        {
+            this->isNegative = false;
+        }
+    }
+    BigIntegerView(const BigInteger & v);
+    const uint32_t * getDigits() const
+    {
+        return digits;
+    }
+    size_t getSize() const
+    {
+        return size;
+    }
+    bool isZero() const
+    {
+        return size == 0;
+    }
+    int sign() const
+    {
+        if(size == 0)
+        {
+            return 0;
+        }
+        return isNegative ? -1 : 1;
+    }
+    const BigIntegerView operator -() const
+    {
+        BigIntegerView retval(*this);
+        retval.isNegative = !isNegative && size != 0;
+        return retval;
+    }
+    friend const BigIntegerView abs(BigIntegerView v)
+    {
+        v.isNegative = false;
+        return v;
+    }
+
+    // the magnitude splits as high(k) * 2^(32 * k) + low(k); both keep the sign
+    const BigIntegerView low(size_t limbCount) const
+    {
+        return BigIntegerView(digits, min(limbCount, size), isNegative);
+    }
+    const BigIntegerView high(size_t limbCount) const
+    {
+        if(limbCount >= size)
+        {
+            return BigIntegerView(digits, 0, false);
+        }
+        return BigIntegerView(digits + limbCount, size - limbCount, isNegative);
+    }
+    const BigIntegerView slice(size_t firstLimb, size_t limbCount) const
+    {
+        return high(firstLimb).low(limbCount);
+    }
+
+    static int compareAbs(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        if(a.size != b.size)
+        {
+            return a.size < b.size ? -1 : 1;
+        }
+        for(size_t i = a.size; i > 0; i--)
+        {
+            if(a.digits[i - 1] != b.digits[i - 1])
+            {
+                return a.digits[i - 1] < b.digits[i - 1] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+    friend int compare(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        if(a.sign() != b.sign())
+        {
+            return a.sign() < b.sign() ? -1 : 1;
+        }
+        int retval = compareAbs(a, b);
+        return a.isNegative ? -retval : retval;
+    }
+    friend bool operator ==(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        return compare(a, b) == 0;
+    }
+    friend bool operator !=(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        return compare(a, b) != 0;
+    }
+    friend bool operator <(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        return compare(a, b) < 0;
+    }
+    friend bool operator >(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        return compare(a, b) > 0;
+    }
+    friend bool operator <=(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        return compare(a, b) <= 0;
+    }
+    friend bool operator >=(const BigIntegerView & a, const BigIntegerView & b)
+    {
+        return compare(a, b) >= 0;
+    }
+    friend const BigInteger operator +(const BigIntegerView & a, const BigIntegerView & b);
+    friend const BigInteger operator -(const BigIntegerView & a, const BigIntegerView & b);
+    friend const BigInteger operator *(const BigIntegerView & a, const BigIntegerView & b);
+    friend ostream & operator <<(ostream & os, const BigIntegerView & v);
+};
+
+// division by an invariant divisor of up to 64 bits with a precomputed Moller-Granlund reciprocal
+// ("Improved division by invariant integers", 2011), so the limb loop only multiplies
+class SmallDivisor
+{
+    friend class BigInteger;
+private:
+    uint64_t divisor, normalizedDivisor, reciprocal;
+    unsigned shift;
+#ifndef __SIZEOF_INT128__ // portable method
+    static void multiply(uint64_t a, uint64_t b, uint64_t & high, uint64_t & low)
+    {
+        uint64_t a0 = static_cast<uint32_t>(a), a1 = a >> 32, b0 = static_cast<uint32_t>(b), b1 = b >> 32;
+        uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+        uint64_t middle = (p00 >> 32) + static_cast<uint32_t>(p01) + static_cast<uint32_t>(p10);
+        low = (middle << 32) | static_cast<uint32_t>(p00);
+        high = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+    }
+    // (2^128 - 1) / normalizedDivisor - 2^64 by long division; only runs once per divisor
+    uint64_t computeReciprocal() const
+    {
+        uint64_t high = ~normalizedDivisor, low = ~static_cast<uint64_t>(0), quotient = 0;
+        for(int i = 0; i < 64; i++)
+        {
+            bool carry = (high >> 63) != 0;
+            high = (high << 1) | (low >> 63);
+            low <<= 1;
+            quotient <<= 1;
+            if(carry || high >= normalizedDivisor)
+            {
+                high -= normalizedDivisor;
+                quotient |= 1;
+            }
+        }
+        return quotient;
+    }
+#else // fast method using the compiler's 128 bit integers
+    static void multiply(uint64_t a, uint64_t b, uint64_t & high, uint64_t & low)
+    {
+        unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        high = static_cast<uint64_t>(product >> 64);
+        low = static_cast<uint64_t>(product);
+    }
+    uint64_t computeReciprocal() const
+    {
+        return static_cast<uint64_t>(~static_cast<unsigned __int128>(0) / normalizedDivisor);
+    }
+#endif
+    // divides high:low by normalizedDivisor; high must be less than normalizedDivisor
+    uint64_t divide2By1(uint64_t high, uint64_t low, uint64_t & remainder) const
+    {
+        uint64_t quotientHigh, quotientLow;
+        multiply(reciprocal, high, quotientHigh, quotientLow);
+        quotientLow += low;
+        quotientHigh += high + 1 + (quotientLow < low ? 1 : 0);
+        remainder = low - quotientHigh * normalizedDivisor;
+        if(remainder > quotientLow)
+        {
+            quotientHigh--;
+            remainder += normalizedDivisor;
+        }
+        if(remainder >= normalizedDivisor)
+        {
+            quotientHigh++;
+            remainder -= normalizedDivisor;
+        }
+        return quotientHigh;
+    }
+    static uint64_t word(const uint32_t * limbs, size_t count, size_t index)
+    {
+        uint64_t retval = limbs[2 * index];
+        if(2 * index + 1 < count)
+        {
+            retval |= static_cast<uint64_t>(limbs[2 * index + 1]) << 32;
+        }
+        return retval;
+    }
+public:
+    explicit SmallDivisor(uint64_t divisor)
+        : divisor(divisor), normalizedDivisor(divisor), shift(0)
+    {
+        if(divisor == 0)
+        {
+            throw new overflow_error("divide by zero");
+        }
+        while((normalizedDivisor >> 63) == 0)
+        {
+            normalizedDivisor <<= 1;
+            shift++;
+        }
+        reciprocal = computeReciprocal();
+    }
+    uint64_t getDivisor() const
+    {
+        return divisor;
+    }
+    // a * b mod the divisor; a and b must be less than the divisor
+    uint64_t mulMod(uint64_t a, uint64_t b) const
+    {
+        uint64_t high, low, remainder;
+        multiply(a, b, high, low);
+        if(shift != 0)
+        {
+            high = high << shift | low >> (64 - shift);
+            low <<= shift;
+        }
+        divide2By1(high, low, remainder);
+        return remainder >> shift;
+    }
+    // divides the count limbs by the divisor, writing the quotient to quotient unless it is NULL; quotient may equal limbs.
+    // returns the remainder
+    uint64_t divideLimbs(uint32_t * quotient, const uint32_t * limbs, size_t count) const
+    {
+        if(count == 0)
+        {
+            return 0;
+        }
+        size_t wordCount = (count + 1) / 2;
+        uint64_t remainder = shift == 0 ? 0 : word(limbs, count, wordCount - 1) >> (64 - shift);
+        for(size_t i = wordCount; i > 0; i--)
+        {
+            uint64_t low = word(limbs, count, i - 1) << shift;
+            if(shift != 0 && i > 1)
+            {
+                low |= word(limbs, count, i - 2) >> (64 - shift);
+            }
+            uint64_t q = divide2By1(remainder, low, remainder);
+            if(quotient != NULL)
+            {
+                quotient[2 * i - 2] = static_cast<uint32_t>(q);
+                if(2 * i - 1 < count)
+                {
+                    quotient[2 * i - 1] = static_cast<uint32_t>(q >> 32);
+                }
+            }
+        }
+        return remainder >> shift;
+    }
+};
+
 class BigInteger
 {
+    friend class BigIntegerView;
+    friend struct BigIntegerExpressionAccess;
+    friend const BigInteger operator +(const BigIntegerView & a, const BigIntegerView & b);
+    friend const BigInteger operator -(const BigIntegerView & a, const BigIntegerView & b);
+    friend const BigInteger operator *(const BigIntegerView & a, const BigIntegerView & b);
 private:
     bool isNegative;
     uint32_t * digits;
@@ -147,6 +574,7 @@ private:
             {
                 newDigits[i] = digits[i];
             }
+            delete []digits;
             digits = newDigits;
         }
         for(size_t i = size; i < clearLength; i++)
@@ -209,6 +637,31 @@ public:
         digits = v.digits;
         isNegative = v.isNegative;
     }
+    // lazy expressions from big_integer_expression.h are evaluated straight into the limbs of *this
+    template <typename E>
+    BigInteger(const BigIntegerExpression<E> & e)
+        : BigInteger()
+    {
+        e.assignTo(*this);
+    }
+    template <typename E>
+    const BigInteger & operator =(const BigIntegerExpression<E> & e)
+    {
+        e.assignTo(*this);
+        return *this;
+    }
+    template <typename E>
+    const BigInteger & operator +=(const BigIntegerExpression<E> & e)
+    {
+        e.addTo(*this, false);
+        return *this;
+    }
+    template <typename E>
+    const BigInteger & operator -=(const BigIntegerExpression<E> & e)
+    {
+        e.addTo(*this, true);
+        return *this;
+    }
     BigInteger(const BigInteger & rt)
     {
         isNegative = rt.isNegative;
@@ -289,952 +742,1618 @@ public:
         return 1;
     }
 
-    const bool operator ==(const BigInteger & r) const
+    static int compareAbs(const BigInteger & a, const BigInteger & b)
     {
-        if(sign() < r.sign())
-        {
-            return false;
-        }
-        if(sign() > r.sign())
+        if(a.referenceCount == b.referenceCount)
         {
-            return false;
+            return 0;
         }
-        if(isZero())
+        return BigIntegerView::compareAbs(a, b);
+    }
+
+    friend int compare(const BigInteger & a, const BigInteger & b)
+    {
+        if(a.sign() != b.sign())
         {
-            return true;
+            return a.sign() < b.sign() ? -1 : 1;
         }
-        if(referenceCount == r.referenceCount)
+        int retval = compareAbs(a, b);
+        return a.isNegative ? -retval : retval;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, int>::type compare(const BigInteger & a, T b)
+    {
+        bool bIsNegative = is_signed<T>::value && static_cast<int64_t>(b) < 0;
+        return a.compareNative(bIsNegative, bIsNegative ? 0 - static_cast<uint64_t>(b) : static_cast<uint64_t>(b));
+    }
+
+private:
+    // compares against the native value with sign isRNegative and magnitude rMagnitude, reading the limbs directly
+    int compareNative(bool isRNegative, uint64_t rMagnitude) const
+    {
+        int rSign = isRNegative ? -1 : (rMagnitude != 0 ? 1 : 0);
+        if(sign() != rSign)
         {
-            return true;
+            return sign() < rSign ? -1 : 1;
         }
-        if(size != r.size)
+        int retval;
+        if(size > 2)
         {
-            return false;
+            retval = 1;
         }
-        for(size_t i = 0, j = size - 1; i < size; i++, j--)
+        else
         {
-            if(digits[j] != r.digits[j])
-            {
-                return false;
-            }
+            uint64_t magnitude = operator [](0) | static_cast<uint64_t>(operator [](1)) << 32;
+            retval = magnitude < rMagnitude ? -1 : (magnitude > rMagnitude ? 1 : 0);
         }
-        return true;
+        return isNegative ? -retval : retval;
+    }
+
+public:
+    const bool operator ==(const BigInteger & r) const
+    {
+        return compare(*this, r) == 0;
+    }
+
+    const bool operator !=(const BigInteger & r) const
+    {
+        return compare(*this, r) != 0;
     }
 
     const bool operator <(const BigInteger & r) const
     {
-        if(sign() < r.sign())
-        {
-            return true;
-        }
-        if(sign() > r.sign())
-        {
-            return false;
-        }
-        if(isZero())
-        {
-            return false;
-        }
-        if(referenceCount == r.referenceCount)
-        {
-            return false;
-        }
-        if(size > r.size)
-        {
-            return isNegative;
-        }
-        if(size < r.size)
-        {
-            return !isNegative;
-        }
-        for(size_t i = 0, j = size - 1; i < size; i++, j--)
-        {
-            if(digits[j] < r.digits[j])
-            {
-                return !isNegative;
-            }
-            if(digits[j] > r.digits[j])
-            {
-                return isNegative;
-            }
-        }
-        return false;
+        return compare(*this, r) < 0;
     }
 
     const bool operator >(const BigInteger & r) const
     {
-        if(sign() < r.sign())
-        {
-            return false;
-        }
-        if(sign() > r.sign())
-        {
-            return true;
-        }
-        if(isZero())
-        {
-            return false;
-        }
-        if(referenceCount == r.referenceCount)
-        {
-            return false;
-        }
-        if(size > r.size)
-        {
-            return !isNegative;
-        }
-        if(size < r.size)
-        {
-            return isNegative;
-        }
-        for(size_t i = 0, j = size - 1; i < size; i++, j--)
-        {
-            if(digits[j] > r.digits[j])
-            {
-                return !isNegative;
-            }
-            if(digits[j] < r.digits[j])
-            {
-                return isNegative;
-            }
-        }
-        return false;
+        return compare(*this, r) > 0;
     }
 
     const bool operator <=(const BigInteger & r) const
     {
-        return !operator >(r);
+        return compare(*this, r) <= 0;
     }
 
     const bool operator >=(const BigInteger & r) const
     {
-        return !operator <(r);
+        return compare(*this, r) >= 0;
     }
 
-    const bool operator !=(const BigInteger & r) const
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator ==(const BigInteger & l, T r)
     {
-        return !operator ==(r);
+        return compare(l, r) == 0;
     }
 
-    const BigInteger & operator +=(const BigInteger & r)
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator !=(const BigInteger & l, T r)
     {
-        if(r.isZero())
-        {
-            return *this;
-        }
-        if(isZero())
-        {
-            return operator =(r);
-        }
-        handleWrite(max(size, r.size) + 1);
-        size_t oldSize = size;
-        size = max(size, r.size) + 1;
-        for(size_t i = oldSize; i <= r.size; i++)
-        {
-            digits[i] = 0;
-        }
-        if((isNegative && r.isNegative) || (!isNegative && !r.isNegative))
-        {
-            uint32_t carry = 0;
-            size_t i;
-            for(i = 0; i < r.size; i++)
-            {
-                uint64_t sum = carry;
-                sum += digits[i];
-                sum += r.digits[i];
-                carry = static_cast<uint32_t>(sum >> 32);
-                digits[i] = static_cast<uint32_t>(sum & ((static_cast<uint64_t>(1) << 32) - 1));
-            }
-            for(; i < size && carry != 0; i++)
-            {
-                uint64_t sum = carry;
-                sum += digits[i];
-                carry = static_cast<uint32_t>(sum >> 32);
-                digits[i] = static_cast<uint32_t>(sum & ((static_cast<uint64_t>(1) << 32) - 1));
-            }
-            normalize();
-            return *this;
-        }
-        else
-        {
-            uint32_t borrow = 0;
-            size_t i;
-            for(i = 0; i < r.size; i++)
-            {
-                uint64_t difference = (static_cast<uint64_t>(1) << 32) - borrow;
-                difference += digits[i];
-                difference -= r.digits[i];
-                borrow = 1 - static_cast<uint32_t>(difference >> 32);
-                digits[i] = static_cast<uint32_t>(difference & ((static_cast<uint64_t>(1) << 32) - 1));
-            }
-            for(; i < size && borrow != 0; i++)
-            {
-                uint64_t difference = (static_cast<uint64_t>(1) << 32) - borrow;
-                difference += digits[i];
-                borrow = 1 - static_cast<uint32_t>(difference >> 32);
-                digits[i] = static_cast<uint32_t>(difference & ((static_cast<uint64_t>(1) << 32) - 1));
-            }
-            if(borrow != 0)
-            {
-                isNegative = !isNegative;
-                for(i = 0; i < size; i++)
-                {
-                    if(digits[i] != 0)
-                    {
-                        break;
-                    }
-                }
-                if(i < size)
-                {
-                    digits[i] = -digits[i];
-                    i++;
-                }
-                for(; i < size; i++)
-                {
-                    digits[i] = ~digits[i];
-                }
-            }
-            normalize();
-            return *this;
-        }
+        return compare(l, r) != 0;
     }
 
-    const BigInteger & operator -=(const BigInteger & r)
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator <(const BigInteger & l, T r)
     {
-        return operator +=(r.operator - ());
+        return compare(l, r) < 0;
     }
 
-    const BigInteger operator +(const BigInteger & r) const
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator >(const BigInteger & l, T r)
     {
-        BigInteger retval(*this);
-        return retval += r;
+        return compare(l, r) > 0;
     }
 
-    const BigInteger operator -(const BigInteger & r) const
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator <=(const BigInteger & l, T r)
     {
-        BigInteger retval(*this);
-        return retval -= r;
+        return compare(l, r) <= 0;
     }
 
-    const BigInteger & operator <<=(size_t shiftAmount)
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator >=(const BigInteger & l, T r)
     {
-        if(shiftAmount == 0 || isZero())
-        {
-            return *this;
-        }
-        size_t newDigitCount = (shiftAmount + 32 - 1) / 32;
-        size_t skipDigitCount = shiftAmount / 32;
-        size_t digitShiftAmount = shiftAmount % 32;
-        handleWrite(size + newDigitCount);
-        if(digitShiftAmount == 0)
-        {
-            size_t size = this->size;
-            this->size += skipDigitCount;
-            for(size_t i = 0, j = size - 1, k = size + skipDigitCount - 1; i < size; i++, j--, k--)
-            {
-                digits[k] = digits[j];
-            }
-            for(size_t i = 0; i < skipDigitCount; i++)
-            {
-                digits[i] = 0;
-            }
-            normalize();
-            return *this;
-        }
-        size_t size = this->size;
-        this->size += newDigitCount;
-        for(size_t i = 0, j = size, k = size + skipDigitCount; i <= size; i++, j--, k--)
-        {
-            if(j == size)
-            {
-                digits[k] = digits[j - 1] >> (32 - digitShiftAmount);
-            }
-            else if(j > 0)
-            {
-                digits[k] = (digits[j - 1] >> (32 - digitShiftAmount)) | (digits[j] << digitShiftAmount);
-            }
-            else
-            {
-                digits[k] = digits[j] << digitShiftAmount;
-            }
-        }
-        for(size_t i = 0; i < skipDigitCount; i++)
+        return compare(l, r) >= 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator ==(T l, const BigInteger & r)
+    {
+        return compare(r, l) == 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator !=(T l, const BigInteger & r)
+    {
+        return compare(r, l) != 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator <(T l, const BigInteger & r)
+    {
+        return compare(r, l) > 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator >(T l, const BigInteger & r)
+    {
+        return compare(r, l) < 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator <=(T l, const BigInteger & r)
+    {
+        return compare(r, l) >= 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, bool>::type operator >=(T l, const BigInteger & r)
+    {
+        return compare(r, l) <= 0;
+    }
+
+#ifdef BIG_INTEGER_HAS_THREE_WAY_COMPARISON
+    friend strong_ordering operator <=>(const BigInteger & l, const BigInteger & r)
+    {
+        return compare(l, r) <=> 0;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, strong_ordering>::type operator <=>(const BigInteger & l, T r)
+    {
+        return compare(l, r) <=> 0;
+    }
+#endif
+
+    const BigInteger & operator +=(const BigInteger & r)
+    {
+        if(isZero())
         {
-            digits[i] = 0;
+            return operator =(r);
         }
-        normalize();
-        return *this;
+        return operator +=(BigIntegerView(r));
     }
 
-    const BigInteger & operator >>=(size_t shiftAmount)
+    const BigInteger & operator +=(const BigIntegerView & r)
     {
-        if(shiftAmount == 0 || isZero())
+        if(r.isZero())
         {
             return *this;
         }
-        size_t skipDigitCount = shiftAmount / 32;
-        size_t digitShiftAmount = shiftAmount % 32;
-        handleWrite(size);
-        bool needRound = false;
-        if(isNegative)
+        if(r.digits >= digits && r.digits < digits + allocated)
         {
-            for(size_t i = 0; i <= skipDigitCount; i++)
-            {
-                if(i == skipDigitCount)
-                {
-                    if(digits[i] - ((digits[i] >> shiftAmount) << shiftAmount) != 0)
-                    {
-                        needRound = true;
-                        break;
-                    }
-                }
-                else if(digits[i] != 0)
-                {
-                    needRound = true;
-                    break;
-                }
-            }
+            return operator +=(BigInteger(r));
         }
-        if(digitShiftAmount == 0)
+        if(isZero())
         {
-            for(size_t i = 0, j = skipDigitCount; j < size; i++, j++)
-            {
-                digits[i] = digits[j];
-            }
-            if(skipDigitCount >= size && needRound)
-            {
-                return *this = BigInteger(-1);
-            }
-            if(skipDigitCount >= size)
-            {
-                return *this = BigInteger(0);
-            }
-            size -= skipDigitCount;
-            normalize();
-            if(needRound)
-            {
-                operator -=(BigInteger(1));
-            }
-            return *this;
+            return operator =(BigInteger(r));
         }
-        for(size_t i = 0, j = skipDigitCount; i < size - skipDigitCount; i++, j++)
+        if(isNegative == r.isNegative)
         {
-            if(j < size - 1)
-            {
-                digits[i] = (digits[j + 1] << (32 - digitShiftAmount)) | (digits[j] >> digitShiftAmount);
-            }
-            else if(j < size)
-            {
-                digits[i] = digits[j] >> digitShiftAmount;
-            }
+            addAbs(r);
         }
-        size -= skipDigitCount;
-        normalize();
-        if(needRound)
+        else
         {
-            operator -=(BigInteger(1));
+            subAbs(r);
         }
         return *this;
     }
 
-    const BigInteger operator <<(size_t shiftAmount) const
-    {
-        BigInteger retval(*this);
-        retval <<= shiftAmount;
-        return retval;
-    }
-
-    const BigInteger operator >>(size_t shiftAmount) const
+    const BigInteger & operator -=(const BigInteger & r)
     {
-        BigInteger retval(*this);
-        retval >>= shiftAmount;
-        return retval;
+        if(isZero())
+        {
+            return operator =(-r);
+        }
+        return operator -=(BigIntegerView(r));
     }
 
-    const BigInteger operator *(const BigInteger & r) const
+    const BigInteger & operator -=(const BigIntegerView & r)
     {
-        if(size > r.size)
+        if(r.isZero())
         {
-            return r.operator * (*this);
+            return *this;
         }
-        BigInteger retval(size + r.size + 1, isNegative ^ r.isNegative);
-        for(size_t i = 0; i < size; i++)
+        if(r.digits >= digits && r.digits < digits + allocated)
         {
-            uint64_t multiplierDigit = digits[i];
-            uint32_t carry = 0;
-            for(size_t j = 0; j < r.size; j++)
-            {
-                uint64_t sum = multiplierDigit * r.digits[j] + carry;
-                sum += retval.digits[i + j];
-                carry = static_cast<uint32_t>(sum >> 32);
-                retval.digits[i + j] = static_cast<uint32_t>(sum); // cut off upper bits
-            }
-            for(size_t j = r.size + i; j <= r.size + size; j++)
-            {
-                if(carry == 0)
-                {
-                    break;
-                }
-                uint64_t sum = retval.digits[j];
-                sum += carry;
-                carry = static_cast<uint32_t>(sum >> 32);
-                retval.digits[j] = static_cast<uint32_t>(sum); // cut off upper bits
-            }
+            return operator -=(BigInteger(r));
         }
-        retval.normalize();
-        return retval;
-    }
-
-    const BigInteger operator *(uint32_t r) const
-    {
-        BigInteger retval(size + 1 + 1, isNegative);
-        uint64_t multiplierDigit = r;
-        uint32_t carry = 0;
-        for(size_t j = 0; j < size; j++)
+        if(isZero())
         {
-            uint64_t sum = multiplierDigit * digits[j] + carry;
-            carry = static_cast<uint32_t>(sum >> 32);
-            retval.digits[j] = static_cast<uint32_t>(sum); // cut off upper bits
+            return operator =(BigInteger(-r));
         }
-        retval.digits[size] = carry;
-        retval.normalize();
-        return retval;
-    }
-
-    const BigInteger operator *(int32_t r) const
-    {
-        bool isRNeg = (r < 0);
-        if(isRNeg)
+        if(isNegative != r.isNegative)
         {
-            r = -r;
+            addAbs(r);
         }
-        BigInteger retval(size + 1 + 1, isNegative ^ isRNeg);
-        uint64_t multiplierDigit = static_cast<uint32_t>(r);
-        uint32_t carry = 0;
-        for(size_t j = 0; j < size; j++)
+        else
         {
-            uint64_t sum = multiplierDigit * digits[j] + carry;
-            carry = static_cast<uint32_t>(sum >> 32);
-            retval.digits[j] = static_cast<uint32_t>(sum); // cut off upper bits
+            subAbs(r);
         }
-        retval.digits[size] = carry;
-        retval.normalize();
-        return retval;
+        return *this;
     }
 
-    friend const BigInteger operator *(uint32_t l, const BigInteger & r)
+    const BigInteger operator +(const BigInteger & r) const
     {
-        return r.operator * (l);
+        return addSigned(*this, r, r.isNegative);
     }
 
-    friend const BigInteger operator *(int32_t l, const BigInteger & r)
+    const BigInteger operator -(const BigInteger & r) const
     {
-        return r.operator * (l);
+        return addSigned(*this, r, !r.isNegative);
     }
 
-    const BigInteger & operator *=(const BigInteger & r)
+private:
+    // dest[i] = a[i] + b[i] for i < aSize, aSize >= bSize; returns the carry out. dest may equal a or b
+    static uint32_t addLimbs(uint32_t * dest, const uint32_t * a, size_t aSize, const uint32_t * b, size_t bSize)
     {
-        return operator =(this->operator *(r));
+        uint64_t carry = limbKernels().addN(dest, a, b, bSize);
+        for(size_t i = bSize; i < aSize; i++)
+        {
+            carry += a[i];
+            dest[i] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        return static_cast<uint32_t>(carry);
     }
 
-    const BigInteger & operator *=(uint32_t r)
+    // dest[i] = a[i] - b[i] for i < aSize; |a| must be at least |b|. dest may equal a or b
+    static void subLimbs(uint32_t * dest, const uint32_t * a, size_t aSize, const uint32_t * b, size_t bSize)
     {
-        return operator =(this->operator *(r));
+        uint32_t borrow = limbKernels().subN(dest, a, b, bSize);
+        for(size_t i = bSize; i < aSize; i++)
+        {
+            uint32_t v = a[i];
+            dest[i] = v - borrow;
+            borrow = borrow & (v == 0);
+        }
     }
 
-    const BigInteger & operator *=(int32_t r)
+    // |*this| += |r|; r must not point into this buffer
+    void addAbs(const BigIntegerView & r)
     {
-        bool isNeg = (r < 0);
-        if(isNeg)
+        size_t newSize = max(size, r.size);
+        handleWrite(newSize + 1);
+        if(size >= r.size)
         {
-            r = -r;
+            digits[newSize] = addLimbs(digits, digits, size, r.digits, r.size);
         }
-        operator =(this->operator *(r));
-        if(isNeg)
+        else
         {
-            isNegative = !isNegative;
+            digits[newSize] = addLimbs(digits, r.digits, r.size, digits, size);
         }
-        return *this;
+        size = newSize + 1;
+        normalize();
     }
 
-    int64_t toInt64() const
+    // |*this| = ||*this| - |r||, flipping the sign if |r| is larger; r must not point into this buffer
+    void subAbs(const BigIntegerView & r)
     {
-        int64_t v = 0;
-        if(size > 1)
+        int cmp = BigIntegerView::compareAbs(*this, r);
+        if(cmp == 0)
         {
-            v = static_cast<int64_t>(digits[1]) << 32;
+            operator =(BigInteger(0));
+            return;
         }
-        v |= digits[0];
-        if(isNegative)
+        if(cmp > 0)
         {
-            return -v;
+            handleWrite(size);
+            subLimbs(digits, digits, size, r.digits, r.size);
         }
-        return v;
-    }
-private:
-    uint32_t operator [](size_t index) const
-    {
-        if(index >= size)
-            return 0;
-        return digits[index];
-    }
-public:
-    friend size_t log2(const BigInteger & v)
-    {
-        if(v.sign() <= 0)
+        else
         {
-            throw new domain_error("can't take the log of a value <= 0");
+            handleWrite(r.size);
+            subLimbs(digits, r.digits, r.size, digits, size);
+            size = r.size;
+            isNegative = !isNegative;
         }
-        return (v.size - 1) * 32 + log2(v.digits[v.size - 1]);
+        normalize();
     }
 
-    const BigInteger divide(uint32_t divisor, uint32_t & remainder) const
+    // a + b with b's sign replaced by bNegative, written straight into a fresh result
+    static const BigInteger addSigned(const BigIntegerView & a, const BigIntegerView & b, bool bNegative)
     {
-        if(divisor == 0)
-        {
-            throw new overflow_error("divide by zero");
-        }
-        BigInteger dividend = *this;
-        if(dividend.isZero())
+        if(b.isZero())
         {
-            remainder = 0;
-            return BigInteger(0);
+            return BigInteger(a);
         }
-        if(dividend.sign() < 0)
+        if(a.isZero())
         {
-            throw new domain_error("can't use divide(uint32_t, uint32_t &) on a negative number");
+            BigInteger retval(b);
+            retval.isNegative = bNegative;
+            return retval;
         }
-        if(dividend.size == 1)
+        if(a.isNegative == bNegative)
         {
-            remainder = dividend.digits[0] % divisor;
-            return BigInteger(dividend.digits[0] / divisor);
+            const BigIntegerView & larger = a.size >= b.size ? a : b;
+            const BigIntegerView & smaller = a.size >= b.size ? b : a;
+            BigInteger retval(larger.size + 1, bNegative);
+            retval.digits[larger.size] = addLimbs(retval.digits, larger.digits, larger.size, smaller.digits, smaller.size);
+            retval.normalize();
+            return retval;
         }
-        if(dividend.size == 2)
+        int cmp = BigIntegerView::compareAbs(a, b);
+        if(cmp == 0)
         {
-            uint64_t v = (static_cast<uint64_t>(dividend.digits[1]) << 32) | dividend.digits[0];
-            remainder = static_cast<uint32_t>(v % divisor);
-            v /= divisor;
-            BigInteger quotient = BigInteger(2, false);
-            quotient.digits[0] = static_cast<uint32_t>(v);
-            quotient.digits[1] = static_cast<uint32_t>(v >> 32);
-            quotient.normalize();
-            return quotient;
+            return BigInteger(0);
         }
-        dividend.handleWrite(dividend.size);
-        uint32_t rem = 0;
-        for(size_t i = 0, j = dividend.size - 1; i < dividend.size; i++, j--)
-        {
-            uint64_t v = rem;
-            v <<= 32;
-            v |= dividend.digits[j];
-            rem = v % divisor;
-            dividend.digits[j] = v / divisor;
-        }
-        remainder = rem;
-        dividend.normalize();
-        return dividend;
+        const BigIntegerView & larger = cmp > 0 ? a : b;
+        const BigIntegerView & smaller = cmp > 0 ? b : a;
+        BigInteger retval(larger.size, cmp > 0 ? a.isNegative : bNegative);
+        subLimbs(retval.digits, larger.digits, larger.size, smaller.digits, smaller.size);
+        retval.normalize();
+        return retval;
     }
 
-    const BigInteger divide(BigInteger divisor, BigInteger & remainder) const
+public:
+    const BigInteger & operator <<=(size_t shiftAmount)
     {
-        if(divisor.isZero())
-        {
-            throw new overflow_error("divide by zero");
-        }
-        if(abs(*this) < abs(divisor))
-        {
-            remainder = *this;
-            return BigInteger(0);
-        }
-        if(abs(*this) == abs(divisor))
-        {
-            remainder = BigInteger(0);
-            if(isNegative ^ divisor.isNegative)
-                return BigInteger(-1);
-            return BigInteger(1);
-        }
-        if(divisor.size == 1)
-        {
-            uint32_t rem;
-            BigInteger quotient = abs(*this).divide(divisor.digits[0], rem);
-            remainder = BigInteger(1, isNegative);
-            remainder.digits[0] = rem;
-            remainder.normalize();
-            if(isNegative ^ divisor.isNegative)
-                return -quotient;
-            return quotient;
-        }
-#if 1
-        size_t dividendScale = log2(divisor) + 1;
-        size_t divisorScale = 32;
-        bool divisorSign = divisor.isNegative;
-        divisor.isNegative = false;
-        BigInteger oldDivisor = divisor;
-        divisor <<= divisorScale;
-        divisorScale += dividendScale;
-        BigInteger x = BigInteger(3) << (divisorScale - 1); // 1.5
-        BigInteger one = BigInteger(1) << divisorScale;
-        BigInteger eps = BigInteger(1);
-        BigInteger lastX = x;
-        do
-        {
-            lastX = x;
-            x = x + (x * (one - (divisor * x >> divisorScale)) >> divisorScale);
-        }
-        while(abs(lastX - x) > eps);
-        BigInteger quotient = x * abs(*this);
-        quotient >>= (dividendScale + divisorScale);
-        remainder = abs(*this) - quotient * abs(oldDivisor);
-        while(remainder < 0)
+        if(shiftAmount == 0 || isZero())
         {
-            remainder += abs(oldDivisor);
-            quotient -= 1;
+            return *this;
         }
-        while(remainder >= abs(oldDivisor))
+        size_t oldSize = size;
+        handleWrite(size + shiftAmount / 32 + 1);
+        shiftLeftInto(digits, digits, oldSize, shiftAmount);
+        size = oldSize + shiftAmount / 32 + 1;
+        normalize();
+        return *this;
+    }
+
+    const BigInteger & operator >>=(size_t shiftAmount)
+    {
+        if(shiftAmount == 0 || isZero())
         {
-            remainder -= abs(oldDivisor);
-            quotient += 1;
+            return *this;
         }
-        if(isNegative)
-            remainder = -remainder;
-        if(isNegative ^ divisorSign)
-            quotient = -quotient;
-        return quotient;
-#else // old slow algorithm
-        BigInteger dividend = abs(*this);
-        BigInteger quotient = BigInteger(dividend.size, isNegative ^ divisor.isNegative);
-        divisor = abs(divisor);
-        size_t count = log2(dividend) - log2(divisor) + 2;
-        BigInteger scaledDivisor = divisor << count;
-        for(size_t i = 0, j = count; i <= count; i++, j--)
+        handleWrite(size);
+        // floor rounding: -|v| >> n == -((|v| >> n) + (any bit shifted out))
+        if(shiftRightMagnitude(shiftAmount) && isNegative)
         {
-            if(dividend >= scaledDivisor)
-            {
-                quotient.digits[j / 32] |= static_cast<uint32_t>(1) << (j % 32);
-                dividend -= scaledDivisor;
-            }
-            scaledDivisor >>= 1;
+            incrementMagnitude();
         }
-        remainder = dividend;
-        remainder.isNegative = isNegative;
-        quotient.normalize();
-        return quotient;
-#endif
+        normalize();
+        return *this;
     }
 
-    const BigInteger operator /(const BigInteger & r) const
+    // shifts the magnitude right, rounding toward zero
+    const BigInteger & shiftRightTruncate(size_t shiftAmount)
     {
-        BigInteger remainder;
-        return divide(r, remainder);
+        if(shiftAmount == 0 || isZero())
+        {
+            return *this;
+        }
+        handleWrite(size);
+        shiftRightMagnitude(shiftAmount);
+        normalize();
+        return *this;
     }
 
-    const BigInteger operator %(const BigInteger & r) const
+    const BigInteger operator <<(size_t shiftAmount) const
     {
-        BigInteger remainder;
-        divide(r, remainder);
-        return remainder;
+        if(shiftAmount == 0 || isZero())
+        {
+            return *this;
+        }
+        BigInteger retval(size + shiftAmount / 32 + 1, isNegative);
+        shiftLeftInto(retval.digits, digits, size, shiftAmount);
+        retval.normalize();
+        return retval;
     }
 
-    const BigInteger operator /=(const BigInteger & r)
+    const BigInteger operator >>(size_t shiftAmount) const
     {
-        return *this = *this / r;
+        BigInteger retval(*this);
+        retval >>= shiftAmount;
+        return retval;
     }
 
-    const BigInteger operator %=(const BigInteger & r)
+private:
+    static uint32_t funnelShift(uint32_t high, uint32_t low, unsigned shiftAmount)
     {
-        return *this = *this % r;
+        return static_cast<uint32_t>((static_cast<uint64_t>(high) << 32 | low) >> (32 - shiftAmount));
     }
 
-    const BigInteger operator ~() const
+    // writes source << shiftAmount into dest[0, count + shiftAmount / 32 + 1); dest may equal source
+    static void shiftLeftInto(uint32_t * dest, const uint32_t * source, size_t count, size_t shiftAmount)
     {
-        return BigInteger(-1) - *this;
+        size_t skipDigitCount = shiftAmount / 32;
+        unsigned digitShiftAmount = shiftAmount % 32;
+        if(digitShiftAmount == 0)
+        {
+            dest[count + skipDigitCount] = 0;
+            for(size_t i = count; i > 0; i--)
+            {
+                dest[i - 1 + skipDigitCount] = source[i - 1];
+            }
+        }
+        else
+        {
+            dest[count + skipDigitCount] = source[count - 1] >> (32 - digitShiftAmount);
+            for(size_t i = count - 1; i > 0; i--)
+            {
+                dest[i + skipDigitCount] = funnelShift(source[i], source[i - 1], digitShiftAmount);
+            }
+            dest[skipDigitCount] = source[0] << digitShiftAmount;
+        }
+        for(size_t i = 0; i < skipDigitCount; i++)
+        {
+            dest[i] = 0;
+        }
     }
 
-    const BigInteger & operator &=(BigInteger r)
+    // shifts the (already unshared) magnitude right in place; returns whether any set bit was shifted out
+    bool shiftRightMagnitude(size_t shiftAmount)
     {
-        if(isZero())
-        {
-            return *this;
-        }
-        if(r.isZero())
+        size_t skipDigitCount = shiftAmount / 32;
+        unsigned digitShiftAmount = shiftAmount % 32;
+        bool lostBits = false;
+        for(size_t i = 0; i < skipDigitCount && i < size && !lostBits; i++)
         {
-            *this = r;
-            return *this;
+            lostBits = digits[i] != 0;
         }
-        size_t newSize = max(size, r.size);
-        if(!isNegative)
+        if(skipDigitCount >= size)
         {
-            newSize = size;
+            size = 1;
+            digits[0] = 0;
+            return lostBits;
         }
-        handleWrite(newSize);
-        size = newSize;
-        bool carryA = isNegative, carryB = r.isNegative;
-        bool newSign = isNegative && r.isNegative;
-        bool carryResult = newSign;
-        for(size_t i = 0; i < size; i++)
+        size_t newSize = size - skipDigitCount;
+        if(digitShiftAmount == 0)
         {
-            uint32_t a = digits[i], b = 0;
-            if(i < r.size)
-            {
-                b = r.digits[i];
-            }
-            if(r.isNegative)
-            {
-                b = ~b;
-            }
-            if(isNegative)
-            {
-                a = ~a;
-            }
-            if(carryA)
-            {
-                if(a == ~static_cast<uint32_t>(0))
-                {
-                    a = 0;
-                }
-                else
-                {
-                    a++;
-                    carryA = false;
-                }
-            }
-            if(carryB)
+            for(size_t i = 0; i < newSize; i++)
             {
-                if(b == ~static_cast<uint32_t>(0))
-                {
-                    b = 0;
-                }
-                else
-                {
-                    b++;
-                    carryB = false;
-                }
+                digits[i] = digits[i + skipDigitCount];
             }
-            uint32_t result = a & b;
-            if(newSign)
+        }
+        else
+        {
+            lostBits = lostBits || (digits[skipDigitCount] << (32 - digitShiftAmount)) != 0;
+            for(size_t i = 0; i < newSize - 1; i++)
             {
-                result = ~result;
+                digits[i] = funnelShift(digits[i + skipDigitCount + 1], digits[i + skipDigitCount], 32 - digitShiftAmount);
             }
-            if(carryResult)
+            digits[newSize - 1] = digits[size - 1] >> digitShiftAmount;
+        }
+        size = newSize;
+        while(size > 1 && digits[size - 1] == 0)
+        {
+            size--;
+        }
+        return lostBits;
+    }
+
+    // adds one to the magnitude in place; the buffer must already be unshared
+    void incrementMagnitude()
+    {
+        for(size_t i = 0; i < size; i++)
+        {
+            if(++digits[i] != 0)
             {
-                if(result == ~static_cast<uint32_t>(0))
-                {
-                    result = 0;
-                }
-                else
-                {
-                    carryResult = false;
-                    result++;
-                }
+                return;
             }
-            digits[i] = result;
         }
-        isNegative = newSign;
-        normalize();
-        return *this;
+        handleWrite(size + 1);
+        digits[size++] = 1;
     }
 
-    friend const BigInteger operator &(BigInteger l, const BigInteger & r)
+    void addShifted(const BigIntegerView & v, size_t offset)
     {
-        return l &= r;
+        uint32_t carry = limbKernels().addN(&digits[offset], &digits[offset], v.digits, v.size);
+        for(size_t i = offset + v.size; carry != 0; i++)
+        {
+            uint64_t sum = digits[i];
+            sum += carry;
+            carry = static_cast<uint32_t>(sum >> 32);
+            digits[i] = static_cast<uint32_t>(sum);
+        }
     }
 
-    const BigInteger & operator |=(BigInteger r)
+    static const BigInteger multiply(const BigIntegerView & a, const BigIntegerView & b)
     {
-        if(r.isZero())
+        if(a.size < b.size)
         {
-            return *this;
+            return multiply(b, a);
         }
-        if(isZero())
+        if(b.size == 0)
         {
-            *this = r;
-            return *this;
+            return BigInteger(0);
         }
-        size_t newSize = max(size, r.size);
-        if(isNegative)
+        BigInteger retval(a.size + b.size, a.isNegative ^ b.isNegative);
+        const LimbKernels & kernels = limbKernels();
+        if(b.size < kernels.karatsubaThreshold)
         {
-            newSize = size;
+            kernels.mulN(retval.digits, a.digits, a.size, b.digits, b.size, a.size + b.size);
         }
-        handleWrite(newSize);
-        size = newSize;
-        bool carryA = isNegative, carryB = r.isNegative;
-        bool newSign = isNegative || r.isNegative;
-        bool carryResult = newSign;
-        for(size_t i = 0; i < size; i++)
+        else if(a.size >= 2 * b.size)
         {
-            uint32_t a = digits[i], b = 0;
-            if(i < r.size)
-            {
-                b = r.digits[i];
-            }
-            if(r.isNegative)
+            for(size_t i = 0; i < a.size; i += b.size)
             {
-                b = ~b;
+                retval.addShifted(multiply(abs(a.slice(i, b.size)), abs(b)), i);
             }
-            if(isNegative)
+        }
+        else // karatsuba
+        {
+            size_t k = a.size / 2;
+            BigIntegerView a0 = abs(a.low(k)), a1 = abs(a.high(k));
+            BigIntegerView b0 = abs(b.low(k)), b1 = abs(b.high(k));
+            BigInteger z0 = multiply(a0, b0);
+            BigInteger z2 = multiply(a1, b1);
+            BigInteger z1 = multiply(a0 + a1, b0 + b1);
+            z1 -= z0;
+            z1 -= z2;
+            retval.addShifted(z0, 0);
+            retval.addShifted(z1, k);
+            retval.addShifted(z2, 2 * k);
+        }
+        retval.normalize();
+        return retval;
+    }
+
+    // montgomery arithmetic modulo an odd n of k limbs with R = 2^(32 * k); every product goes
+    // through the kernel mulN, so it picks up the simd multiplies for mid-size moduli
+    class Montgomery
+    {
+    private:
+        size_t k;
+        vector<uint32_t> n, negativeInverse, t, u, m;
+        const LimbKernels & kernels;
+    public:
+        vector<uint32_t> one, rSquared;
+        Montgomery(const BigInteger & modulus)
+            : k(modulus.size), n(modulus.digits, modulus.digits + modulus.size), negativeInverse(k), t(2 * k), u(2 * k), m(k), kernels(limbKernels()), one(k), rSquared(k)
+        {
+            // newton iteration for n^-1 mod 2^bits, doubling the bits every step
+            BigInteger inverse(1), absModulus = abs(modulus);
+            for(size_t bits = 1; bits < 32 * k; )
             {
-                a = ~a;
+                bits = min(bits * 2, 32 * k);
+                BigInteger product = (absModulus * inverse).lowBits(bits);
+                inverse = (inverse * ((BigInteger(1) << bits) + 2 - product)).lowBits(bits);
             }
-            if(carryA)
+            ((BigInteger(1) << (32 * k)) - inverse).exportLimbs(&negativeInverse[0], k);
+            // R^2 mod n by doubling, so no division is needed
+            BigInteger r(1);
+            for(size_t i = 0; i < 64 * k; i++)
             {
-                if(a == ~static_cast<uint32_t>(0))
-                {
-                    a = 0;
-                }
-                else
+                r <<= 1;
+                if(r >= absModulus)
                 {
-                    a++;
-                    carryA = false;
+                    r -= absModulus;
                 }
             }
-            if(carryB)
+            r.exportLimbs(&rSquared[0], k);
+            one[0] = 1;
+        }
+        // out = x * y / R mod n for x, y < n; out may alias x or y
+        void multiply(uint32_t * out, const uint32_t * x, const uint32_t * y)
+        {
+            kernels.mulN(&t[0], x, k, y, k, 2 * k);
+            kernels.mulN(&m[0], &t[0], k, &negativeInverse[0], k, k);
+            kernels.mulN(&u[0], &m[0], k, &n[0], k, 2 * k);
+            // the low k limbs of t + u are zero
+            uint32_t carry = kernels.addN(&t[0], &t[0], &u[0], 2 * k);
+            bool reduce = carry != 0;
+            for(size_t i = k; i > 0 && !reduce; i--)
             {
-                if(b == ~static_cast<uint32_t>(0))
+                if(t[k + i - 1] != n[i - 1])
                 {
-                    b = 0;
+                    reduce = t[k + i - 1] > n[i - 1];
+                    break;
                 }
-                else
+                if(i == 1)
                 {
-                    b++;
-                    carryB = false;
+                    reduce = true;
                 }
             }
-            uint32_t result = a | b;
-            if(newSign)
+            if(reduce)
             {
-                result = ~result;
+                kernels.subN(out, &t[k], &n[0], k);
             }
-            if(carryResult)
+            else
             {
-                if(result == ~static_cast<uint32_t>(0))
-                {
-                    result = 0;
-                }
-                else
-                {
-                    carryResult = false;
-                    result++;
-                }
+                memcpy(out, &t[k], k * sizeof(uint32_t));
             }
-            digits[i] = result;
         }
-        isNegative = newSign;
-        normalize();
-        return *this;
-    }
+        const BigInteger toBigInteger(const uint32_t * x) const
+        {
+            BigInteger retval(k, false);
+            memcpy(retval.digits, x, k * sizeof(uint32_t));
+            retval.normalize();
+            return retval;
+        }
+    };
 
-    friend const BigInteger operator |(BigInteger l, const BigInteger & r)
+    // copies the magnitude into count limbs, zero extended
+    void exportLimbs(uint32_t * limbs, size_t count) const
     {
-        return l |= r;
+        for(size_t i = 0; i < count; i++)
+        {
+            limbs[i] = operator [](i);
+        }
     }
 
-    const BigInteger & operator ^=(BigInteger r)
+    // |base|^exponent mod n for an odd n > 1 and |base| < n, using 4 bit fixed windows
+    static const BigInteger montgomeryModPow(const BigInteger & base, const BigInteger & exponent, const BigInteger & modulus)
     {
-        if(r.isZero())
-        {
-            return *this;
-        }
-        if(isZero())
-        {
-            *this = r;
-            return *this;
-        }
-        size_t newSize = max(size, r.size);
-        if(isNegative)
+        const size_t windowBits = 4;
+        Montgomery context(modulus);
+        size_t k = modulus.size;
+        vector<uint32_t> table((1 << windowBits) * k), retval(k), x(k);
+        abs(base).exportLimbs(&x[0], k);
+        context.multiply(&table[k], &x[0], &context.rSquared[0]);
+        context.multiply(&table[0], &context.one[0], &context.rSquared[0]);
+        for(size_t i = 2; i < (1 << windowBits); i++)
         {
-            newSize = size;
+            context.multiply(&table[i * k], &table[(i - 1) * k], &table[k]);
         }
-        handleWrite(newSize);
-        size = newSize;
-        bool carryA = isNegative, carryB = r.isNegative;
-        bool newSign = isNegative ^ r.isNegative;
-        bool carryResult = newSign;
-        for(size_t i = 0; i < size; i++)
+        size_t windowCount = (exponent.bitLength() + windowBits - 1) / windowBits;
+        retval.assign(table.begin(), table.begin() + k);
+        for(size_t i = windowCount; i > 0; i--)
         {
-            uint32_t a = digits[i], b = 0;
-            if(i < r.size)
-            {
-                b = r.digits[i];
-            }
-            if(r.isNegative)
-            {
-                b = ~b;
-            }
-            if(isNegative)
-            {
-                a = ~a;
-            }
-            if(carryA)
-            {
-                if(a == ~static_cast<uint32_t>(0))
-                {
-                    a = 0;
-                }
-                else
-                {
-                    a++;
-                    carryA = false;
-                }
-            }
-            if(carryB)
+            if(i != windowCount)
             {
-                if(b == ~static_cast<uint32_t>(0))
-                {
-                    b = 0;
-                }
-                else
+                for(size_t j = 0; j < windowBits; j++)
                 {
-                    b++;
-                    carryB = false;
+                    context.multiply(&retval[0], &retval[0], &retval[0]);
                 }
             }
-            uint32_t result = a ^ b;
-            if(newSign)
+            size_t window = 0;
+            for(size_t j = windowBits; j > 0; j--)
             {
-                result = ~result;
+                window = window * 2 + (exponent.testBit((i - 1) * windowBits + j - 1) ? 1 : 0);
             }
-            if(carryResult)
+            if(window != 0)
             {
-                if(result == ~static_cast<uint32_t>(0))
-                {
-                    result = 0;
-                }
-                else
-                {
-                    carryResult = false;
-                    result++;
-                }
+                context.multiply(&retval[0], &retval[0], &table[window * k]);
             }
-            digits[i] = result;
         }
-        isNegative = newSign;
-        normalize();
-        return *this;
+        context.multiply(&retval[0], &retval[0], &context.one[0]);
+        return context.toBigInteger(&retval[0]);
     }
-
-    friend const BigInteger operator ^(BigInteger l, const BigInteger & r)
+public:
+    const BigInteger operator *(const BigInteger & r) const
     {
-        return l ^= r;
+        return multiply(*this, r);
     }
 
-    friend const BigInteger abs(BigInteger v)
+    const BigInteger & operator *=(const BigInteger & r)
     {
-        v.isNegative = false;
-        return v;
+        return operator =(this->operator *(r));
     }
 
-    friend const BigInteger gcd(BigInteger a, BigInteger b)
+    // fused multiply add : the product is accumulated straight into the limbs of *this when one factor
+    // has at most fusedProductLimbs limbs, otherwise it is built once and added in place
+    const BigInteger & addMul(const BigInteger & a, const BigInteger & b)
     {
-        if(a.isZero() || b.isZero())
+        if(&a == this || &b == this)
         {
-            return BigInteger(0);
+            BigInteger copy(*this);
+            return addMul(&a == this ? copy : a, &b == this ? copy : b);
         }
-        a = abs(a);
-        b = abs(b);
-        for(;;)
+        addProduct(a, b, a.isNegative != b.isNegative);
+        return *this;
+    }
+
+    const BigInteger & subMul(const BigInteger & a, const BigInteger & b)
+    {
+        if(&a == this || &b == this)
         {
-            BigInteger c = a % b;
-            if(c.isZero())
+            BigInteger copy(*this);
+            return subMul(&a == this ? copy : a, &b == this ? copy : b);
+        }
+        addProduct(a, b, a.isNegative == b.isNegative);
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type addMul(const BigInteger & a, T b)
+    {
+        if(&a == this)
+        {
+            BigInteger copy(*this);
+            return addMul(copy, b);
+        }
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(b, limbs);
+        addProduct(a, v, a.isNegative != v.isNegative);
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type subMul(const BigInteger & a, T b)
+    {
+        if(&a == this)
+        {
+            BigInteger copy(*this);
+            return subMul(copy, b);
+        }
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(b, limbs);
+        addProduct(a, v, a.isNegative == v.isNegative);
+        return *this;
+    }
+
+    // *this = *this * multiplier + addend
+    const BigInteger & mulAdd(const BigInteger & multiplier, const BigInteger & addend)
+    {
+        BigInteger retval(addend);
+        retval.addMul(*this, multiplier);
+        return operator =(retval);
+    }
+
+private:
+    static const size_t fusedProductLimbs = 8;
+
+    // *this += a * b with the product's sign given by isProductNegative; a and b must not point into this buffer
+    void addProduct(const BigIntegerView & a, const BigIntegerView & b, bool isProductNegative)
+    {
+        const BigIntegerView & longer = a.size >= b.size ? a : b;
+        const BigIntegerView & shorter = a.size >= b.size ? b : a;
+        if(shorter.isZero())
+        {
+            return;
+        }
+        if(shorter.size > fusedProductLimbs)
+        {
+            BigInteger product = multiply(longer, shorter);
+            product.isNegative = isProductNegative;
+            operator +=(BigIntegerView(product));
+            return;
+        }
+        if(isZero())
+        {
+            isNegative = isProductNegative;
+        }
+        bool isSubtraction = isNegative != isProductNegative;
+        size_t newSize = max(size, longer.size + shorter.size) + 1;
+        handleWrite(newSize);
+        size = newSize;
+        const LimbKernels & kernels = limbKernels();
+        uint32_t borrow = 0;
+        for(size_t i = 0; i < shorter.size; i++)
+        {
+            if(isSubtraction)
+            {
+                borrow |= subtractMultiple(&digits[i], newSize - i, longer.digits, longer.size, shorter.digits[i], kernels);
+            }
+            else
+            {
+                addMultiple(&digits[i], newSize - i, longer.digits, longer.size, shorter.digits[i], kernels);
+            }
+        }
+        if(borrow != 0)
+        {
+            // the product was the larger one, so the limbs hold 2^(32 * newSize) - |result|
+            bool carry = true;
+            for(size_t i = 0; i < newSize; i++)
+            {
+                digits[i] = ~digits[i] + (carry ? 1 : 0);
+                carry = carry && digits[i] == 0;
+            }
+            isNegative = !isNegative;
+        }
+        normalize();
+    }
+
+public:
+
+    int64_t toInt64() const
+    {
+        int64_t v = 0;
+        if(size > 1)
+        {
+            v = static_cast<int64_t>(digits[1]) << 32;
+        }
+        v |= digits[0];
+        if(isNegative)
+        {
+            return -v;
+        }
+        return v;
+    }
+private:
+    uint32_t operator [](size_t index) const
+    {
+        if(index >= size)
+            return 0;
+        return digits[index];
+    }
+public:
+    friend size_t log2(const BigInteger & v)
+    {
+        if(v.sign() <= 0)
+        {
+            throw new domain_error("can't take the log of a value <= 0");
+        }
+        return (v.size - 1) * 32 + log2(v.digits[v.size - 1]);
+    }
+
+    const BigInteger divide(uint32_t divisor, uint32_t & remainder) const
+    {
+        if(divisor == 0)
+        {
+            throw new overflow_error("divide by zero");
+        }
+        BigInteger dividend = *this;
+        if(dividend.isZero())
+        {
+            remainder = 0;
+            return BigInteger(0);
+        }
+        if(dividend.sign() < 0)
+        {
+            throw new domain_error("can't use divide(uint32_t, uint32_t &) on a negative number");
+        }
+        remainder = static_cast<uint32_t>(dividend.divideInPlace(static_cast<uint64_t>(divisor)));
+        return dividend;
+    }
+
+    // quotient rounded toward zero; remainder gets |*this| mod divisor
+    const BigInteger divRem(const SmallDivisor & divisor, uint64_t & remainder) const
+    {
+        BigInteger retval(*this);
+        remainder = retval.divideInPlace(divisor);
+        return retval;
+    }
+
+    // |*this| mod divisor
+    uint64_t mod(const SmallDivisor & divisor) const
+    {
+        return divisor.divideLimbs(NULL, digits, size);
+    }
+
+private:
+    // v^-1 mod 2^64 for an odd v by newton iteration; each step doubles the number of correct bits
+    static uint64_t inverseMod2To64(uint64_t v)
+    {
+        uint64_t inverse = (3 * v) ^ 2; // correct to 5 bits
+        for(int i = 0; i < 4; i++)
+        {
+            inverse *= 2 - v * inverse;
+        }
+        return inverse;
+    }
+
+    // r[0, count) += q * d[0, dCount) for count >= dCount; returns the carry out of the top of r
+    static uint32_t addMultiple(uint32_t * r, size_t count, const uint32_t * d, size_t dCount, uint32_t q, const LimbKernels & kernels)
+    {
+        uint32_t carry = kernels.addMul1(r, d, dCount, q);
+        for(size_t i = dCount; carry != 0 && i < count; i++)
+        {
+            r[i] += carry;
+            carry = r[i] < carry ? 1 : 0;
+        }
+        return carry;
+    }
+
+    // r[0, count) -= q * d[0, dCount) for count >= dCount; returns the borrow out of the top of r
+    static uint32_t subtractMultiple(uint32_t * r, size_t count, const uint32_t * d, size_t dCount, uint32_t q, const LimbKernels & kernels)
+    {
+        uint32_t borrow = kernels.subMul1(r, d, dCount, q);
+        for(size_t i = dCount; borrow != 0 && i < count; i++)
+        {
+            uint32_t limb = r[i];
+            r[i] = limb - borrow;
+            borrow = limb < borrow ? 1 : 0;
+        }
+        return borrow;
+    }
+
+public:
+    // the quotient of a division known to be exact, by Jebelean's right to left method : each quotient limb is
+    // the low limb of the running remainder times divisor^-1 mod 2^32, so there is no quotient estimate to correct.
+    // the result is meaningless if divisor doesn't divide *this
+    const BigInteger divExact(const BigInteger & divisor) const
+    {
+        if(divisor.isZero())
+        {
+            throw new overflow_error("divide by zero");
+        }
+        bool isQuotientNegative = isNegative ^ divisor.isNegative;
+        if(divisor.size <= 2)
+        {
+            BigInteger retval = *this;
+            retval.divideInPlace(divisor.digits[0] | static_cast<uint64_t>(divisor[1]) << 32);
+            retval.isNegative = isQuotientNegative && !retval.isZero();
+            return retval;
+        }
+        // strip the power of 2 so the divisor is odd and has an inverse
+        size_t zeros = divisor.countTrailingZeros();
+        BigInteger dividend = abs(*this) >> zeros, oddDivisor = abs(divisor) >> zeros;
+        if(dividend.size < oddDivisor.size)
+        {
+            return BigInteger(0);
+        }
+        // the quotient fits in quotientSize limbs, so only the low quotientSize limbs of the dividend matter
+        size_t quotientSize = dividend.size - oddDivisor.size + 1;
+        BigInteger retval(quotientSize, isQuotientNegative);
+        memcpy(retval.digits, dividend.digits, quotientSize * sizeof(uint32_t));
+        uint32_t inverse = static_cast<uint32_t>(inverseMod2To64(oddDivisor.digits[0]));
+        const LimbKernels & kernels = limbKernels();
+        for(size_t i = 0; i < quotientSize; i++)
+        {
+            uint32_t q = retval.digits[i] * inverse;
+            subtractMultiple(&retval.digits[i], quotientSize - i, oddDivisor.digits, min(oddDivisor.size, quotientSize - i), q, kernels);
+            retval.digits[i] = q;
+        }
+        retval.normalize();
+        return retval;
+    }
+
+    // whether divisor divides *this, without building a quotient : odd divisors use the hensel remainder, so
+    // the loop only multiplies by divisor^-1 mod 2^64. every value is divisible by 0 only if it is 0
+    bool isDivisibleBy(uint64_t divisor) const
+    {
+        if(divisor == 0)
+        {
+            return isZero();
+        }
+        if(size <= 2)
+        {
+            return (operator [](0) | static_cast<uint64_t>(operator [](1)) << 32) % divisor == 0;
+        }
+        size_t zeros = static_cast<uint32_t>(divisor) != 0 ? ::countTrailingZeros(static_cast<uint32_t>(divisor)) : 32 + ::countTrailingZeros(static_cast<uint32_t>(divisor >> 32));
+        if(countTrailingZeros() < zeros)
+        {
+            return false;
+        }
+        uint64_t oddDivisor = divisor >> zeros;
+        if(oddDivisor == 1)
+        {
+            return true;
+        }
+        // each step subtracts the multiple of oddDivisor that clears the low word, so
+        // |*this| = q * oddDivisor - carry * 2^(64 * words) and the divisibility is decided by carry
+        uint64_t inverse = inverseMod2To64(oddDivisor), carry = 0;
+        for(size_t i = 0; i < size; i += 2)
+        {
+            uint64_t word = digits[i] | static_cast<uint64_t>(operator [](i + 1)) << 32;
+            uint64_t high, low;
+            SmallDivisor::multiply((word - carry) * inverse, oddDivisor, high, low);
+            carry = high + (word < carry ? 1 : 0);
+        }
+        return carry == 0 || carry == oddDivisor;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, bool>::type isDivisibleBy(T divisor) const
+    {
+        bool isDivisorNegative = is_signed<T>::value && static_cast<int64_t>(divisor) < 0;
+        return isDivisibleBy(isDivisorNegative ? 0 - static_cast<uint64_t>(divisor) : static_cast<uint64_t>(divisor));
+    }
+
+    bool isDivisibleBy(const BigInteger & divisor) const
+    {
+        if(divisor.size <= 2)
+        {
+            return isDivisibleBy(divisor.digits[0] | static_cast<uint64_t>(divisor[1]) << 32);
+        }
+        if(compareAbs(*this, divisor) < 0)
+        {
+            return isZero();
+        }
+        size_t zeros = divisor.countTrailingZeros();
+        if(countTrailingZeros() < zeros)
+        {
+            return false;
+        }
+        // hensel reduction : clearing the low size - oddDivisor.size + 1 limbs leaves
+        // (|*this| - q * oddDivisor) / 2^(32 * cleared limbs), which is less than oddDivisor in magnitude, so it
+        // is zero exactly when oddDivisor divides *this
+        BigInteger oddDivisor = abs(divisor) >> zeros;
+        vector<uint32_t> r(digits, digits + size);
+        size_t clearedSize = size - oddDivisor.size + 1;
+        uint32_t inverse = static_cast<uint32_t>(inverseMod2To64(oddDivisor.digits[0]));
+        const LimbKernels & kernels = limbKernels();
+        for(size_t i = 0; i < clearedSize; i++)
+        {
+            if(subtractMultiple(&r[i], size - i, oddDivisor.digits, oddDivisor.size, r[i] * inverse, kernels) != 0)
+            {
+                return false;
+            }
+        }
+        for(size_t i = clearedSize; i < size; i++)
+        {
+            if(r[i] != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const BigInteger divide(const BigInteger & divisor, BigInteger & remainder) const
+    {
+        pair<BigInteger, BigInteger> retval = divMod(*this, divisor);
+        remainder = retval.second;
+        return retval.first;
+    }
+
+    // a = quotient * b + remainder with the quotient rounded as asked, so the remainder takes the sign of a
+    // for Truncate, the sign of b for Floor and the opposite sign for Ceiling
+    friend const pair<BigInteger, BigInteger> divMod(const BigInteger & a, const BigInteger & b, Rounding rounding = Rounding::Truncate)
+    {
+        if(b.isZero())
+        {
+            throw new overflow_error("divide by zero");
+        }
+        pair<BigInteger, BigInteger> retval;
+        divideMagnitudes(a, b, retval.first, retval.second);
+        bool isQuotientNegative = a.isNegative != b.isNegative;
+        bool isRemainderNegative = a.isNegative;
+        if(!retval.second.isZero() && rounding != Rounding::Truncate && isQuotientNegative == (rounding == Rounding::Floor))
+        {
+            // move the quotient one step away from zero
+            retval.first.handleWrite(retval.first.size);
+            retval.first.incrementMagnitude();
+            retval.second = addSigned(abs(BigIntegerView(b)), retval.second, true);
+            isRemainderNegative = !isRemainderNegative;
+        }
+        retval.first.isNegative = isQuotientNegative && !retval.first.isZero();
+        retval.second.isNegative = isRemainderNegative && !retval.second.isZero();
+        return retval;
+    }
+
+private:
+    // |a| = quotient * |b| + remainder with 0 <= remainder < |b| by knuth's algorithm D (TAOCP vol 2, 4.3.1);
+    // b must not be zero. quotient and remainder may share storage with a or b
+    static void divideMagnitudes(const BigIntegerView & a, const BigIntegerView & b, BigInteger & quotient, BigInteger & remainder)
+    {
+        if(BigIntegerView::compareAbs(a, b) < 0)
+        {
+            BigInteger r(abs(a));
+            quotient = BigInteger(0);
+            remainder = r;
+            return;
+        }
+        if(b.size <= 2)
+        {
+            BigInteger q(abs(a));
+            uint64_t r = q.divideInPlace(b.digits[0] | (b.size > 1 ? static_cast<uint64_t>(b.digits[1]) << 32 : 0));
+            quotient = q;
+            remainder = fromMagnitude(r, false);
+            return;
+        }
+        // scale both so the divisor's top limb has its high bit set, which keeps each quotient estimate within 2 of the limb
+        size_t n = b.size, m = a.size - n;
+        unsigned shift = 31 - log2(b.digits[n - 1]);
+        BigInteger v(n + 1, false), r(a.size + 1, false), q(m + 1, false);
+        shiftLeftInto(v.digits, b.digits, n, shift);
+        shiftLeftInto(r.digits, a.digits, a.size, shift);
+        uint32_t * u = r.digits;
+        uint64_t top = v.digits[n - 1], second = v.digits[n - 2];
+        const LimbKernels & kernels = limbKernels();
+        for(size_t j = m + 1; j > 0; j--)
+        {
+            uint32_t * window = u + j - 1;
+            uint64_t numerator = static_cast<uint64_t>(window[n]) << 32 | window[n - 1];
+            uint64_t qHat = numerator / top, rHat = numerator % top;
+            while(qHat > 0xFFFFFFFF || qHat * second > (rHat << 32 | window[n - 2]))
+            {
+                qHat--;
+                rHat += top;
+                if(rHat > 0xFFFFFFFF)
+                {
+                    break;
+                }
+            }
+            uint32_t borrow = kernels.subMul1(window, v.digits, n, static_cast<uint32_t>(qHat));
+            uint32_t topLimb = window[n];
+            window[n] = topLimb - borrow;
+            if(topLimb < borrow)
+            {
+                // the estimate was one too large; add the divisor back
+                qHat--;
+                window[n] += kernels.addN(window, window, v.digits, n);
+            }
+            q.digits[j - 1] = static_cast<uint32_t>(qHat);
+        }
+        q.normalize();
+        r.size = n;
+        r.shiftRightMagnitude(shift);
+        r.normalize();
+        quotient = q;
+        remainder = r;
+    }
+
+public:
+
+    const BigInteger operator /(const BigInteger & r) const
+    {
+        return divMod(*this, r).first;
+    }
+
+    const BigInteger operator %(const BigInteger & r) const
+    {
+        return divMod(*this, r).second;
+    }
+
+    const BigInteger operator /=(const BigInteger & r)
+    {
+        return *this = *this / r;
+    }
+
+    const BigInteger operator %=(const BigInteger & r)
+    {
+        return *this = *this % r;
+    }
+
+    const BigInteger operator ~() const
+    {
+        return -1 - *this;
+    }
+
+private:
+    // operation is applied limb by limb to the two's complement forms
+    template <typename Operation>
+    void bitwiseAssign(const BigIntegerView & r, Operation operation)
+    {
+        if(r.digits >= digits && r.digits < digits + allocated)
+        {
+            BigInteger copy(r);
+            bitwiseAssign(copy, operation);
+            return;
+        }
+        if(!isNegative && !r.isNegative)
+        {
+            size_t newSize = max(size, r.size);
+            if(operation(0, ~static_cast<uint32_t>(0)) == 0) // and
+            {
+                newSize = min(size, r.size);
+            }
+            handleWrite(newSize);
+            for(size_t i = 0; i < newSize; i++)
+            {
+                digits[i] = operation(digits[i], i < r.size ? r.digits[i] : 0);
+            }
+            size = newSize;
+            normalize();
+            return;
+        }
+        size_t newSize = max(size, r.size) + 1;
+        handleWrite(newSize);
+        bool newSign = operation(isNegative ? ~static_cast<uint32_t>(0) : 0, r.isNegative ? ~static_cast<uint32_t>(0) : 0) != 0;
+        uint32_t borrowA = (isNegative ? 1 : 0), borrowB = (r.isNegative ? 1 : 0), carryResult = (newSign ? 1 : 0);
+        for(size_t i = 0; i < newSize; i++)
+        {
+            uint32_t a = digits[i], b = (i < r.size ? r.digits[i] : 0);
+            if(isNegative)
+            {
+                uint32_t v = a - borrowA;
+                borrowA = (a < borrowA ? 1 : 0);
+                a = ~v;
+            }
+            if(r.isNegative)
+            {
+                uint32_t v = b - borrowB;
+                borrowB = (b < borrowB ? 1 : 0);
+                b = ~v;
+            }
+            uint32_t result = operation(a, b);
+            if(newSign)
+            {
+                uint32_t v = ~result;
+                result = v + carryResult;
+                carryResult = (result < v ? 1 : 0);
+            }
+            digits[i] = result;
+        }
+        size = newSize;
+        isNegative = newSign;
+        normalize();
+    }
+public:
+    const BigInteger & operator &=(const BigInteger & r)
+    {
+        bitwiseAssign(r, [](uint32_t a, uint32_t b)
+        {
+            return a & b;
+        });
+        return *this;
+    }
+
+    friend const BigInteger operator &(BigInteger l, const BigInteger & r)
+    {
+        return l &= r;
+    }
+
+    const BigInteger & operator |=(const BigInteger & r)
+    {
+        bitwiseAssign(r, [](uint32_t a, uint32_t b)
+        {
+            return a | b;
+        });
+        return *this;
+    }
+
+    friend const BigInteger operator |(BigInteger l, const BigInteger & r)
+    {
+        return l |= r;
+    }
+
+    const BigInteger & operator ^=(const BigInteger & r)
+    {
+        bitwiseAssign(r, [](uint32_t a, uint32_t b)
+        {
+            return a ^ b;
+        });
+        return *this;
+    }
+
+    friend const BigInteger operator ^(BigInteger l, const BigInteger & r)
+    {
+        return l ^= r;
+    }
+
+private:
+    // a view of a native integer, using limbs as its storage
+    template <typename T>
+    static const BigIntegerView nativeView(T v, uint32_t (&limbs)[2])
+    {
+        bool isVNegative = is_signed<T>::value && static_cast<int64_t>(v) < 0;
+        uint64_t magnitude = isVNegative ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+        limbs[0] = static_cast<uint32_t>(magnitude);
+        limbs[1] = static_cast<uint32_t>(magnitude >> 32);
+        return BigIntegerView(limbs, 2, isVNegative);
+    }
+
+    // |*this| mod divisor without touching *this
+    uint64_t modAbs(uint64_t divisor) const
+    {
+        if(size > 2)
+        {
+            return mod(SmallDivisor(divisor));
+        }
+        if(divisor == 0)
+        {
+            throw new overflow_error("divide by zero");
+        }
+        return (operator [](0) | static_cast<uint64_t>(operator [](1)) << 32) % divisor;
+    }
+
+    static const BigInteger fromMagnitude(uint64_t magnitude, bool isNegative)
+    {
+        BigInteger retval(2, isNegative);
+        retval.digits[0] = static_cast<uint32_t>(magnitude);
+        retval.digits[1] = static_cast<uint32_t>(magnitude >> 32);
+        retval.normalize();
+        return retval;
+    }
+
+public:
+    // native integer operands : the value is viewed in place on the stack, so no temporary BigInteger is built;
+    // division and remainder truncate like the BigInteger versions
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator +=(T r)
+    {
+        uint32_t limbs[2];
+        return operator +=(nativeView(r, limbs));
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator -=(T r)
+    {
+        uint32_t limbs[2];
+        return operator -=(nativeView(r, limbs));
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator *=(T r)
+    {
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(r, limbs);
+        if(v.size > 1)
+        {
+            return operator =(multiply(*this, v));
+        }
+        if(v.size == 0)
+        {
+            return operator =(BigInteger(0));
+        }
+        handleWrite(size + 1);
+        digits[size] = limbKernels().mul1(digits, digits, size, limbs[0]);
+        size++;
+        isNegative = isNegative != v.isNegative;
+        normalize();
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator /=(T r)
+    {
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(r, limbs);
+        bool isQuotientNegative = isNegative != v.isNegative;
+        divideInPlace(limbs[0] | static_cast<uint64_t>(limbs[1]) << 32);
+        isNegative = isQuotientNegative && !isZero();
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator %=(T r)
+    {
+        uint32_t limbs[2];
+        nativeView(r, limbs);
+        uint64_t remainder = modAbs(limbs[0] | static_cast<uint64_t>(limbs[1]) << 32);
+        handleWrite(2);
+        size = 2;
+        digits[0] = static_cast<uint32_t>(remainder);
+        digits[1] = static_cast<uint32_t>(remainder >> 32);
+        normalize();
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator &=(T r)
+    {
+        uint32_t limbs[2];
+        bitwiseAssign(nativeView(r, limbs), [](uint32_t a, uint32_t b)
+        {
+            return a & b;
+        });
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator |=(T r)
+    {
+        uint32_t limbs[2];
+        bitwiseAssign(nativeView(r, limbs), [](uint32_t a, uint32_t b)
+        {
+            return a | b;
+        });
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger &>::type operator ^=(T r)
+    {
+        uint32_t limbs[2];
+        bitwiseAssign(nativeView(r, limbs), [](uint32_t a, uint32_t b)
+        {
+            return a ^ b;
+        });
+        return *this;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator +(T r) const
+    {
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(r, limbs);
+        return addSigned(*this, v, v.isNegative);
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator -(T r) const
+    {
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(r, limbs);
+        return addSigned(*this, v, !v.isNegative);
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator *(T r) const
+    {
+        uint32_t limbs[2];
+        BigIntegerView v = nativeView(r, limbs);
+        if(v.size != 1)
+        {
+            return multiply(*this, v);
+        }
+        BigInteger retval(size + 1, isNegative != v.isNegative);
+        retval.digits[size] = limbKernels().mul1(retval.digits, digits, size, limbs[0]);
+        retval.normalize();
+        return retval;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator /(T r) const
+    {
+        BigInteger retval(*this);
+        return retval /= r;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator %(T r) const
+    {
+        uint32_t limbs[2];
+        nativeView(r, limbs);
+        return fromMagnitude(modAbs(limbs[0] | static_cast<uint64_t>(limbs[1]) << 32), isNegative);
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator &(T r) const
+    {
+        BigInteger retval(*this);
+        return retval &= r;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator |(T r) const
+    {
+        BigInteger retval(*this);
+        return retval |= r;
+    }
+
+    template <typename T>
+    typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator ^(T r) const
+    {
+        BigInteger retval(*this);
+        return retval ^= r;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator +(T l, const BigInteger & r)
+    {
+        return r + l;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator -(T l, const BigInteger & r)
+    {
+        uint32_t limbs[2];
+        return addSigned(nativeView(l, limbs), r, !r.isNegative);
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator *(T l, const BigInteger & r)
+    {
+        return r * l;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator /(T l, const BigInteger & r)
+    {
+        uint32_t limbs[2];
+        return BigInteger(nativeView(l, limbs)) / r;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator %(T l, const BigInteger & r)
+    {
+        uint32_t limbs[2];
+        return BigInteger(nativeView(l, limbs)) % r;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator &(T l, const BigInteger & r)
+    {
+        return r & l;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator |(T l, const BigInteger & r)
+    {
+        return r | l;
+    }
+
+    template <typename T>
+    friend typename enable_if<isNativeInteger<T>::value, const BigInteger>::type operator ^(T l, const BigInteger & r)
+    {
+        return r ^ l;
+    }
+
+    // bit operations use two's complement semantics for negative numbers
+    bool testBit(size_t index) const
+    {
+        bool bit = ((operator [](index / 32) >> (index % 32)) & 1) != 0;
+        if(!isNegative)
+        {
+            return bit;
+        }
+        size_t lowestSetBit = countTrailingZeros();
+        if(index <= lowestSetBit)
+        {
+            return index == lowestSetBit;
+        }
+        return !bit;
+    }
+
+    const BigInteger & setBit(size_t index)
+    {
+        if(isNegative)
+        {
+            return operator |=(BigInteger(1) << index);
+        }
+        handleWrite(index / 32 + 1);
+        size = max(size, index / 32 + 1);
+        digits[index / 32] |= static_cast<uint32_t>(1) << (index % 32);
+        return *this;
+    }
+
+    const BigInteger & clearBit(size_t index)
+    {
+        if(isNegative)
+        {
+            return operator &=(~(BigInteger(1) << index));
+        }
+        if(index / 32 >= size)
+        {
+            return *this;
+        }
+        handleWrite(size);
+        digits[index / 32] &= ~(static_cast<uint32_t>(1) << (index % 32));
+        normalize();
+        return *this;
+    }
+
+    const BigInteger & flipBit(size_t index)
+    {
+        if(testBit(index))
+        {
+            return clearBit(index);
+        }
+        return setBit(index);
+    }
+
+    // the number of bits that differ from the sign bit
+    size_t popcount() const
+    {
+        size_t retval = 0;
+        for(size_t i = 0; i < size; i++)
+        {
+            retval += ::popcount(digits[i]);
+        }
+        if(isNegative)
+        {
+            retval += countTrailingZeros() - 1;
+        }
+        return retval;
+    }
+
+    size_t countTrailingZeros() const
+    {
+        if(isZero())
+        {
+            throw new domain_error("can't count the trailing zeros of zero");
+        }
+        size_t i = 0;
+        while(digits[i] == 0)
+        {
+            i++;
+        }
+        return i * 32 + ::countTrailingZeros(digits[i]);
+    }
+
+    // the low bitCount bits of the two's complement form, always >= 0
+    const BigInteger lowBits(size_t bitCount) const
+    {
+        size_t limbCount = (bitCount + 31) / 32;
+        BigInteger retval(BigIntegerView(digits, min(size, limbCount), false));
+        if(retval.size == limbCount && bitCount % 32 != 0)
+        {
+            retval.digits[limbCount - 1] &= (static_cast<uint32_t>(1) << (bitCount % 32)) - 1;
+            retval.normalize();
+        }
+        if(isNegative && !retval.isZero())
+        {
+            BigInteger modulus = BigInteger(0).setBit(bitCount);
+            return modulus -= retval;
+        }
+        return retval;
+    }
+
+    friend const BigInteger abs(BigInteger v)
+    {
+        v.isNegative = false;
+        return v;
+    }
+
+    friend const BigInteger gcd(BigInteger a, BigInteger b)
+    {
+        if(a.isZero() || b.isZero())
+        {
+            return BigInteger(0);
+        }
+        a = abs(a);
+        b = abs(b);
+        for(;;)
+        {
+            BigInteger c = a % b;
+            if(c.isZero())
             {
                 return b;
             }
@@ -1246,49 +2365,268 @@ public:
 
 
 private:
-    static void writeHelper(ostream & os, BigInteger v, size_t expectedLength)
+    static int digitValue(int ch)
+    {
+        if(ch >= '0' && ch <= '9')
+        {
+            return ch - '0';
+        }
+        if(ch >= 'a' && ch <= 'z')
+        {
+            return ch - 'a' + 0xA;
+        }
+        if(ch >= 'A' && ch <= 'Z')
+        {
+            return ch - 'A' + 0xA;
+        }
+        return -1;
+    }
+
+    static const char * skipDigits(const char * first, const char * last, int base)
     {
-        BigInteger divisor("10000000000000000000");
-        const size_t log10Divisor = 19;
-        if(v >= divisor)
+        for(; first != last; first++)
         {
-            size_t l = log10Divisor;
-            BigInteger nextPower = divisor * divisor;
-            while(v >= nextPower)
+            int digit = digitValue(*first);
+            if(digit < 0 || digit >= base)
             {
-                divisor = nextPower;
-                nextPower = divisor * divisor;
-                l *= 2;
+                break;
             }
-            BigInteger remainder;
-            writeHelper(os, v.divide(divisor, remainder), (expectedLength > l ? expectedLength - l : 0));
-            writeHelper(os, remainder, l);
         }
-        else
+        return first;
+    }
+
+    static int powerOf2Bits(int base)
+    {
+        switch(base)
+        {
+        case 2:
+            return 1;
+        case 4:
+            return 2;
+        case 8:
+            return 3;
+        case 16:
+            return 4;
+        case 32:
+            return 5;
+        default:
+            return 0;
+        }
+    }
+
+    static void checkBase(int base)
+    {
+        if(base < 2 || base > 36)
+        {
+            throw new domain_error("base out of range");
+        }
+    }
+
+    // the largest power of base that fits in a limb
+    static uint32_t chunkBase(int base, int & digitsPerChunk)
+    {
+        uint64_t retval = base;
+        digitsPerChunk = 1;
+        while(retval * base <= 0xFFFFFFFFU)
+        {
+            retval *= base;
+            digitsPerChunk++;
+        }
+        return static_cast<uint32_t>(retval);
+    }
+
+    void mulAddInPlace(uint32_t multiplier, uint32_t addend)
+    {
+        handleWrite(size + 1);
+        digits[size] = limbKernels().mul1(digits, digits, size, multiplier);
+        size++;
+        for(size_t i = 0; addend != 0; i++)
+        {
+            digits[i] += addend;
+            addend = digits[i] < addend ? 1 : 0;
+        }
+        normalize();
+    }
+
+    // divides the magnitude in place and returns the remainder of the magnitude
+    uint64_t divideInPlace(const SmallDivisor & divisor)
+    {
+        handleWrite(size);
+        uint64_t remainder = divisor.divideLimbs(digits, digits, size);
+        normalize();
+        return remainder;
+    }
+
+    uint64_t divideInPlace(uint64_t divisor)
+    {
+        if(size > 2)
+        {
+            return divideInPlace(SmallDivisor(divisor));
+        }
+        if(divisor == 0)
+        {
+            throw new overflow_error("divide by zero");
+        }
+        handleWrite(2);
+        uint64_t v = digits[0] | static_cast<uint64_t>(digits[1]) << 32;
+        digits[0] = static_cast<uint32_t>(v / divisor);
+        digits[1] = static_cast<uint32_t>(v / divisor >> 32);
+        size = 2;
+        normalize();
+        return v % divisor;
+    }
+
+    // packs the digits straight into limbs; [first, last) must only contain valid digits
+    static const BigInteger parsePowerOf2(const char * first, const char * last, int bitsPerDigit)
+    {
+        size_t bitCount = static_cast<size_t>(last - first) * bitsPerDigit;
+        BigInteger retval(bitCount / 32 + 1, false);
+        uint64_t accumulator = 0;
+        int accumulatorBits = 0;
+        size_t j = 0;
+        for(const char * i = last; i != first;)
+        {
+            i--;
+            accumulator |= static_cast<uint64_t>(digitValue(*i)) << accumulatorBits;
+            accumulatorBits += bitsPerDigit;
+            if(accumulatorBits >= 32)
+            {
+                retval.digits[j++] = static_cast<uint32_t>(accumulator);
+                accumulator >>= 32;
+                accumulatorBits -= 32;
+            }
+        }
+        if(accumulatorBits > 0)
+        {
+            retval.digits[j] = static_cast<uint32_t>(accumulator);
+        }
+        retval.normalize();
+        return retval;
+    }
+
+    uint32_t extractBits(size_t bitIndex, int bitCount) const
+    {
+        size_t index = bitIndex / 32;
+        uint64_t v = (static_cast<uint64_t>(operator [](index + 1)) << 32) | operator [](index);
+        v >>= bitIndex % 32;
+        return static_cast<uint32_t>(v & ((static_cast<uint64_t>(1) << bitCount) - 1));
+    }
+
+    size_t powerOf2DigitCount(int bitsPerDigit) const
+    {
+        return max<size_t>(1, (bitLength() + bitsPerDigit - 1) / bitsPerDigit);
+    }
+
+    // writes digits [firstDigit, firstDigit + count) of the magnitude, most significant first
+    void formatPowerOf2(char * str, size_t firstDigit, size_t count, int bitsPerDigit, bool uppercase) const
+    {
+        const char * digitChars = uppercase ? "0123456789ABCDEFGHIJKLMNOPQRSTUV" : "0123456789abcdefghijklmnopqrstuv";
+        for(size_t i = 0, k = firstDigit + count - 1; i < count; i++, k--)
+        {
+            str[i] = digitChars[extractBits(k * bitsPerDigit, bitsPerDigit)];
+        }
+    }
+
+    static void writePowerOf2(ostream & os, const BigInteger & v, int bitsPerDigit, bool uppercase)
+    {
+        char buffer[256];
+        size_t digitCount = v.powerOf2DigitCount(bitsPerDigit);
+        while(digitCount > 0)
+        {
+            size_t count = min(digitCount, sizeof(buffer));
+            digitCount -= count;
+            v.formatPowerOf2(buffer, digitCount, count, bitsPerDigit, uppercase);
+            os.write(buffer, count);
+        }
+    }
+
+    // [first, last) must only contain valid digits
+    static const BigInteger parseDigits(const char * first, const char * last, int base)
+    {
+        int bitsPerDigit = powerOf2Bits(base);
+        if(bitsPerDigit != 0)
+        {
+            return parsePowerOf2(first, last, bitsPerDigit);
+        }
+        int digitsPerChunk;
+        chunkBase(base, digitsPerChunk);
+        size_t digitCount = static_cast<size_t>(last - first);
+        BigInteger retval(digitCount * (log2(static_cast<uint32_t>(base)) + 1) / 32 + 2, false);
+        retval.size = 1;
+        size_t chunkLength = digitCount % digitsPerChunk;
+        if(chunkLength == 0)
+        {
+            chunkLength = digitsPerChunk;
+        }
+        while(first != last)
         {
-            uint64_t r = v.toInt64();
-            char str[log10Divisor + 1] = {0};
-            for(size_t i = 0; i < log10Divisor; i++)
+            uint32_t chunk = 0, multiplier = 1;
+            for(size_t i = 0; i < chunkLength; i++, first++)
             {
-                str[log10Divisor - i - 1] = static_cast<char>(r % 10 + '0');
-                r /= 10;
+                chunk = chunk * base + digitValue(*first);
+                multiplier *= base;
             }
-            char * strp = &str[0];
-            size_t l = strlen(strp);
-            while(*strp == '0' && expectedLength < l)
+            retval.mulAddInPlace(multiplier, chunk);
+            chunkLength = digitsPerChunk;
+        }
+        return retval;
+    }
+
+    // writes v backwards ending at last, zero padded to width digits; returns the first digit written or NULL if out of room
+    static char * formatDigits(char * first, char * last, BigInteger v, size_t width, int base, vector<BigInteger> & powers)
+    {
+        int digitsPerChunk;
+        uint32_t divisor = chunkBase(base, digitsPerChunk);
+        if(v.size > 64)
+        {
+            if(powers.empty())
+            {
+                powers.push_back(BigInteger(divisor));
+            }
+            while(powers.back() <= v)
             {
-                strp++;
-                l--;
+                powers.push_back(powers.back() * powers.back());
             }
-            for(size_t i = l; i < expectedLength; i++)
+            size_t i = powers.size() - 2;
+            while(powers[i] > v)
             {
-                os << '0';
+                i--;
             }
-            if(*strp)
+            size_t l = static_cast<size_t>(digitsPerChunk) << i;
+            pair<BigInteger, BigInteger> parts = divMod(v, powers[i]);
+            last = formatDigits(first, last, parts.second, l, base, powers);
+            if(last == NULL)
             {
-                os << strp;
+                return NULL;
+            }
+            return formatDigits(first, last, parts.first, (width > l ? width - l : 0), base, powers);
+        }
+        // peel off two chunks per pass over v
+        SmallDivisor wideDivisor(static_cast<uint64_t>(divisor) * divisor);
+        while(!v.isZero() || width > 0)
+        {
+            uint64_t wideChunk = v.divideInPlace(wideDivisor);
+            uint32_t chunks[2] = {static_cast<uint32_t>(wideChunk % divisor), static_cast<uint32_t>(wideChunk / divisor)};
+            for(int j = 0; j < 2; j++)
+            {
+                uint32_t chunk = chunks[j];
+                bool moreChunks = (j == 0 && chunks[1] != 0) || !v.isZero();
+                for(int i = 0; i < digitsPerChunk && (width > 0 || chunk != 0 || moreChunks); i++)
+                {
+                    if(last == first)
+                    {
+                        return NULL;
+                    }
+                    *--last = "0123456789abcdefghijklmnopqrstuvwxyz"[chunk % base];
+                    chunk /= base;
+                    if(width > 0)
+                    {
+                        width--;
+                    }
+                }
             }
         }
+        return last;
     }
 public:
     friend ostream & operator <<(ostream & os, BigInteger v)
@@ -1301,91 +2639,127 @@ public:
         if((os.flags() & os.basefield) == os.hex)
         {
             os << "0x";
-            bool isFirst = true;
-            for(size_t i = 0, j = v.size - 1; i < v.size; i++, j--)
-            {
-                for(int k = 32 - 4; k >= 0; k -= 4)
-                {
-                    uint32_t digit = v.digits[j] >> k;
-                    digit &= 0xF;
-                    if(isFirst && digit == 0)
-                    {
-                        continue;
-                    }
-                    isFirst = false;
-                    if(digit >= 0xA)
-                    {
-                        os << static_cast<char>(digit + 'A' - '\xA');
-                    }
-                    else
-                    {
-                        os << static_cast<char>(digit + '0');
-                    }
-                }
-            }
-            if(isFirst)
+            writePowerOf2(os, v, 4, true);
+            return os;
+        }
+        if((os.flags() & os.basefield) == os.oct)
+        {
+            os << '0';
+            if(!v.isZero())
             {
-                return os << '0';
+                writePowerOf2(os, v, 3, true);
             }
             return os;
         }
-        if(v.isZero())
-            return os << "0";
-        writeHelper(os, v, true);
-        return os;
+        char buffer[256];
+        size_t length = v.digitsNeeded();
+        if(length <= sizeof(buffer))
+        {
+            return os.write(buffer, v.toChars(buffer, buffer + length) - buffer);
+        }
+        return os << static_cast<string>(v);
     }
 
     explicit operator string() const
     {
-        ostringstream os;
-        os << *this;
-        return os.str();
+        return toString();
     }
 
-    static const BigInteger parseHex(string v)
+    string toString(int base = 10) const
     {
-        const char * str = v.c_str();
-        BigInteger retval(0);
-        while(*str == ' ' || *str == '\t')
-        {
-            str++;
-        }
-        bool isNegative = false;
-        if(*str == '-' || *str == '+')
+        string retval(digitsNeeded(base), '\0');
+        retval.resize(toChars(&retval[0], &retval[0] + retval.size(), base) - &retval[0]);
+        return retval;
+    }
+
+    size_t digitsNeeded(int base = 10) const
+    {
+        checkBase(base);
+        size_t signLength = (isNegative ? 1 : 0);
+        int bitsPerDigit = powerOf2Bits(base);
+        if(bitsPerDigit != 0)
         {
-            isNegative = (*str == '-');
-            str++;
+            return signLength + powerOf2DigitCount(bitsPerDigit);
         }
-        while(*str && isxdigit(*str))
+        int digitsPerChunk;
+        int bitsPerChunk = log2(chunkBase(base, digitsPerChunk));
+        return signLength + digitsPerChunk * (bitLength() / bitsPerChunk + 1);
+    }
+
+    char * toChars(char * first, char * last, int base = 10) const
+    {
+        checkBase(base);
+        if(isNegative)
         {
-            int digit;
-            if(isupper(*str))
+            if(first == last)
             {
-                digit = *str - 'A' + 0xA;
+                return NULL;
             }
-            else if(islower(*str))
+            *first++ = '-';
+        }
+        int bitsPerDigit = powerOf2Bits(base);
+        if(bitsPerDigit != 0)
+        {
+            size_t digitCount = powerOf2DigitCount(bitsPerDigit);
+            if(static_cast<size_t>(last - first) < digitCount)
             {
-                digit = *str - 'a' + 0xA;
+                return NULL;
             }
-            else
+            formatPowerOf2(first, 0, digitCount, bitsPerDigit, false);
+            return first + digitCount;
+        }
+        if(isZero())
+        {
+            if(first == last)
             {
-                digit = *str - '0';
+                return NULL;
             }
-            retval <<= 4;
-            retval += BigInteger(digit);
+            *first = '0';
+            return first + 1;
+        }
+        vector<BigInteger> powers;
+        char * start = formatDigits(first, last, abs(*this), 0, base, powers);
+        if(start == NULL)
+        {
+            return NULL;
+        }
+        size_t length = last - start;
+        memmove(first, start, length);
+        return first + length;
+    }
+
+    const char * fromChars(const char * first, const char * last, int base = 10)
+    {
+        checkBase(base);
+        const char * str = first;
+        bool isNegative = false;
+        if(str != last && *str == '-')
+        {
+            isNegative = true;
             str++;
         }
+        const char * digitsEnd = skipDigits(str, last, base);
+        if(digitsEnd == str)
+        {
+            return first;
+        }
+        *this = parseDigits(str, digitsEnd, base);
         if(isNegative)
         {
-            retval = -retval;
+            *this = -*this;
         }
-        return retval;
+        return digitsEnd;
     }
 
-    static const BigInteger parseOct(string v)
+    size_t bitLength() const
+    {
+        return (size - 1) * 32 + log2(digits[size - 1]) + 1;
+    }
+
+private:
+    static const BigInteger parsePowerOf2(string v, int bitsPerDigit)
     {
         const char * str = v.c_str();
-        BigInteger retval(0);
         while(*str == ' ' || *str == '\t')
         {
             str++;
@@ -1396,24 +2770,37 @@ public:
             isNegative = (*str == '-');
             str++;
         }
-        while(*str && isdigit(*str))
-        {
-            int digit = *str - '0';
-            retval <<= 3;
-            retval += BigInteger(digit);
-            str++;
-        }
+        BigInteger retval = parsePowerOf2(str, skipDigits(str, v.c_str() + v.size(), 1 << bitsPerDigit), bitsPerDigit);
         if(isNegative)
         {
             retval = -retval;
         }
         return retval;
     }
+public:
+    static const BigInteger parseHex(string v)
+    {
+        return parsePowerOf2(v, 4);
+    }
+
+    static const BigInteger parseOct(string v)
+    {
+        return parsePowerOf2(v, 3);
+    }
+
+    static const BigInteger parseBin(string v)
+    {
+        return parsePowerOf2(v, 1);
+    }
+
+    static const BigInteger parseBase32(string v)
+    {
+        return parsePowerOf2(v, 5);
+    }
 
     static const BigInteger parseDec(string v)
     {
         const char * str = v.c_str();
-        BigInteger retval(0);
         while(*str == ' ' || *str == '\t')
         {
             str++;
@@ -1424,13 +2811,7 @@ public:
             isNegative = (*str == '-');
             str++;
         }
-        while(*str && isdigit(*str))
-        {
-            int digit = *str - '0';
-            retval *= BigInteger(10);
-            retval += BigInteger(digit);
-            str++;
-        }
+        BigInteger retval = parseDigits(str, skipDigits(str, v.c_str() + v.size(), 10), 10);
         if(isNegative)
         {
             retval = -retval;
@@ -1509,7 +2890,6 @@ public:
         }
         bool isNegative = false;
         v = BigInteger(0);
-        bool gotDigit = false;
         if(signOrDigit == '+' || signOrDigit == '-')
         {
             if(signOrDigit == '-')
@@ -1530,26 +2910,12 @@ public:
                 char X = is.get();
                 if(isxdigit(is.peek()))
                 {
-                    v = BigInteger(0);
+                    string digitString;
                     while(isxdigit(is.peek()))
                     {
-                        int digit;
-                        if(isupper(is.peek()))
-                        {
-                            digit = is.peek() - 'A' + 0xA;
-                        }
-                        else if(islower(is.peek()))
-                        {
-                            digit = is.peek() - 'a' + 0xA;
-                        }
-                        else
-                        {
-                            digit = is.peek() - '0';
-                        }
-                        v <<= 4;
-                        v += BigInteger(digit);
-                        is.get();
+                        digitString += static_cast<char>(is.get());
                     }
+                    v = parsePowerOf2(digitString.data(), digitString.data() + digitString.size(), 4);
                     return is;
                 }
                 else
@@ -1561,40 +2927,39 @@ public:
             }
             else if(!arg.allowOctal)
             {
-                v = BigInteger(0);
+                string digitString;
                 while(isdigit(is.peek()))
                 {
-                    v *= BigInteger(10);
-                    v += BigInteger(is.get() - '0');
+                    digitString += static_cast<char>(is.get());
                 }
+                v = parseDigits(digitString.data(), digitString.data() + digitString.size(), 10);
                 return is;
             }
             else
             {
-                v = BigInteger(0);
-                while(isdigit(is.peek()))
+                string digitString;
+                while(is.peek() >= '0' && is.peek() <= '7')
                 {
-                    v <<= 3;
-                    v += BigInteger(is.get() - '0');
+                    digitString += static_cast<char>(is.get());
                 }
+                v = parsePowerOf2(digitString.data(), digitString.data() + digitString.size(), 3);
                 return is;
             }
         }
-        else
+        string digitString;
+        if(isdigit(signOrDigit))
         {
-            v = BigInteger(signOrDigit - '0');
-            gotDigit = true;
+            digitString += signOrDigit;
         }
         while(isdigit(is.peek()) && is)
         {
-            v *= BigInteger(10);
-            v += BigInteger(is.get() - '0');
-            gotDigit = true;
+            digitString += static_cast<char>(is.get());
         }
-        if(!gotDigit)
+        if(digitString.empty())
         {
             is.setstate(istream::failbit);
         }
+        v = parseDigits(digitString.data(), digitString.data() + digitString.size(), 10);
         if(isNegative)
         {
             v = -v;
@@ -1609,17 +2974,15 @@ public:
             throw new domain_error("can't use modPow with exponent < 0");
         }
         BigInteger retval = base;
-        if((exponent & BigInteger(1)).isZero())
+        if(!exponent.testBit(0))
         {
             retval = BigInteger(1);
         }
-        exponent &= ~BigInteger(1);
-        for(BigInteger v = BigInteger(2); !exponent.isZero(); v <<= 1)
+        for(size_t i = 1, bitLength = exponent.bitLength(); i < bitLength; i++)
         {
             base *= base;
-            if(!(exponent & v).isZero())
+            if(exponent.testBit(i))
             {
-                exponent &= ~v;
                 retval *= base;
             }
         }
@@ -1632,118 +2995,238 @@ public:
         {
             throw new domain_error("can't use modPow with exponent < 0");
         }
-        if(abs(modulus) <= BigInteger(1))
+        if(modulus >= -1 && modulus <= 1)
         {
             return BigInteger(0);
         }
-        base %= modulus;
-        BigInteger retval = base;
-        if((exponent & BigInteger(1)).isZero())
+        // work on magnitudes; the result takes the sign of base^exponent like the truncating %
+        bool isResultNegative = base.isNegative && exponent.testBit(0);
+        modulus = abs(modulus);
+        base = divMod(abs(base), modulus).second;
+        BigInteger retval;
+        if(modulus.testBit(0))
         {
-            retval = BigInteger(1);
+            retval = montgomeryModPow(base, exponent, modulus);
         }
-        exponent &= ~BigInteger(1);
-        for(BigInteger v = BigInteger(2); !exponent.isZero(); v <<= 1)
+        else
         {
-            base *= base;
-            base %= modulus;
-            if(!(exponent & v).isZero())
+            retval = exponent.testBit(0) ? base : BigInteger(1);
+            for(size_t i = 1, bitLength = exponent.bitLength(); i < bitLength; i++)
             {
-                exponent &= ~v;
-                retval *= base;
-                retval %= modulus;
+                base = divMod(base * base, modulus).second;
+                if(exponent.testBit(i))
+                {
+                    retval = divMod(retval * base, modulus).second;
+                }
             }
         }
+        if(isResultNegative)
+        {
+            retval = -retval;
+        }
         return retval;
     }
 
+private:
+    // fills the limbs of *this with a uniform random value of up to bits bits; *this must be unshared with room for them
+    void fillRandom(size_t bits, bool useSecureRandom)
+    {
+        size = (bits + 31) / 32;
+        randomLimbs(digits, size, useSecureRandom);
+        if(bits % 32 != 0)
+        {
+            digits[size - 1] &= (static_cast<uint32_t>(1) << bits % 32) - 1;
+        }
+        isNegative = false;
+        normalize();
+    }
+
+public:
+    // a uniform random value in [0, 2^bits)
     static BigInteger random(size_t bits, bool useSecureRandom = false)
     {
-        if(bits > 10)
+        if(bits == 0)
+        {
+            return BigInteger(0);
+        }
+        BigInteger retval((bits + 31) / 32, false);
+        retval.fillRandom(bits, useSecureRandom);
+        return retval;
+    }
+
+    // a uniform random value in [0, n) for n > 0, drawing bitLength(n - 1) bits until the value is below n,
+    // so more than half of the draws are kept and there is no bias from reducing modulo n
+    static BigInteger randomBelow(const BigInteger & n, bool useSecureRandom = false)
+    {
+        if(n <= 0)
+        {
+            throw new domain_error("randomBelow needs a positive bound");
+        }
+        if(n == 1)
+        {
+            return BigInteger(0);
+        }
+        size_t bits = (n - 1).bitLength();
+        BigInteger retval((bits + 31) / 32, false);
+        do
         {
-            size_t a = bits / 2;
-            return (random(bits - a, useSecureRandom) << a) | random(a, useSecureRandom);
+            retval.fillRandom(bits, useSecureRandom);
         }
-        return BigInteger(randomDigit(1 << bits, useSecureRandom));
+        while(retval >= n);
+        return retval;
     }
 
     friend bool isProbablePrime(BigInteger n, size_t log2Probability = 100, bool useSecureRandom = false)
     {
-        if(n <= BigInteger(1))
+        if(n <= 1)
             return false;
-        if(n <= BigInteger(3))
+        if(n <= 3)
             return true;
         size_t k = (log2Probability + 1) / 2;
-        if((n >> 1) << 1 == n)
-            return false;
-        if(n % BigInteger(3) == BigInteger(0))
-            return false;
-        if(n == BigInteger(5))
-            return true;
-        if(n % BigInteger(5) == BigInteger(0))
-            return false;
-        if(n == BigInteger(7))
-            return true;
-        if(n % BigInteger(7) == BigInteger(0))
-            return false;
-        if(n == BigInteger(11))
-            return true;
-        if(n % BigInteger(11) == BigInteger(0))
-            return false;
-        if(n == BigInteger(13))
-            return true;
-        if(n % BigInteger(13) == BigInteger(0))
+        if(!n.testBit(0))
             return false;
-        if(n <= BigInteger(13 * 13))
-            return true;
-        BigInteger d = n - BigInteger(1);
-        size_t s = 0;
-        while((d & BigInteger(1)).isZero())
+        // trial division by the odd primes below trialDivisionLimit : one pass over the limbs of n per group of
+        // primes whose product fits in a word, then a native remainder per prime
+        const vector<uint32_t> & primes = smallPrimes();
+        const vector<SmallDivisor> & groups = smallPrimeGroups();
+        for(size_t g = 0, i = 0; g < groups.size(); g++)
         {
-            d >>= 1;
-            s++;
+            uint64_t product = groups[g].getDivisor();
+            uint64_t r = n.mod(groups[g]);
+            for(; i < primes.size() && product % primes[i] == 0; i++)
+            {
+                if(r % primes[i] == 0)
+                    return n == primes[i];
+            }
         }
+        // a composite with no factor below the limit is at least its square
+        if(n < static_cast<int64_t>(trialDivisionLimit) * trialDivisionLimit)
+            return true;
+        BigInteger nMinusOne = n - 1;
+        BigInteger d = nMinusOne;
+        size_t s = d.countTrailingZeros();
+        d >>= s;
         for(size_t i = 0; i < k; i++)
         {
-            BigInteger rv = BigInteger::random(2 + log2(n), useSecureRandom) % (n - BigInteger(3)) + BigInteger(2);
+            BigInteger rv = randomBelow(n - 3, useSecureRandom) + 2;
             BigInteger x = modPow(rv, d, n);
-            if(x == BigInteger(1) || x == n - BigInteger(1))
+            if(x == 1 || x == nMinusOne)
                 continue;
             for(size_t j = 1; ; j++)
             {
                 if(j >= s)
                     return false;
                 x = (x * x) % n;
-                if(x == BigInteger(1))
+                if(x == 1)
                     return false;
-                if(x == n - BigInteger(1))
+                if(x == nMinusOne)
                     break;
             }
         }
         return true;
     }
 
+private:
+    // the odd primes below 2^16, sieved on first use
+    static const vector<uint32_t> & smallPrimes()
+    {
+        static const vector<uint32_t> primes = []()
+        {
+            const uint32_t limit = 1 << 16;
+            vector<bool> isComposite(limit, false);
+            vector<uint32_t> retval;
+            for(uint32_t i = 3; i < limit; i += 2)
+            {
+                if(isComposite[i])
+                    continue;
+                retval.push_back(i);
+                for(uint32_t j = i * i; j < limit; j += 2 * i)
+                {
+                    isComposite[j] = true;
+                }
+            }
+            return retval;
+        }();
+        return primes;
+    }
+
+    // isProbablePrime trial divides by the odd primes below this
+    static const uint32_t trialDivisionLimit = 1 << 12;
+
+    // the odd primes below trialDivisionLimit in order, packed into products that fit in a word
+    static const vector<SmallDivisor> & smallPrimeGroups()
+    {
+        static const vector<SmallDivisor> groups = []()
+        {
+            const vector<uint32_t> & primes = smallPrimes();
+            vector<SmallDivisor> retval;
+            for(size_t i = 0; i < primes.size() && primes[i] < trialDivisionLimit;)
+            {
+                uint64_t product = 1;
+                for(; i < primes.size() && primes[i] < trialDivisionLimit && product <= UINT64_MAX / primes[i]; i++)
+                {
+                    product *= primes[i];
+                }
+                retval.push_back(SmallDivisor(product));
+            }
+            return retval;
+        }();
+        return groups;
+    }
+
+    // the number of odd candidates makeProbablePrime sieves after each random start
+    static const size_t primeSieveLength = 4096;
+
+public:
+    // searches up from a random odd start : the odd numbers after it are sieved by the small primes, each with one
+    // word sized residue of the start, and only the survivors go through isProbablePrime; a new start is drawn when
+    // the sieve runs out or the search leaves the range of bits + 1 bit numbers
     static BigInteger makeProbablePrime(size_t bits, size_t log2Probability = 100, bool useGenSecureRandom = true, bool useTestSecureRandom = false)
     {
         if(bits < 3)
             bits = 3;
+        const vector<uint32_t> & primes = smallPrimes();
+        vector<bool> isComposite(primeSieveLength);
         int dotCount = 1;
         cout << "\x1B[s\n";
         for(;;)
         {
-            BigInteger n = (random(bits - 2, useGenSecureRandom) << 1) | (BigInteger(1) << bits) | BigInteger(1);
-            cout << "Testing";
-            for(int i = 0; i < dotCount; i++)
-                cout << ".";
-            cout << "\x1B[K\r";
-            cout.flush();
-            dotCount %= 10;
-            dotCount++;
-            if(isProbablePrime(n, log2Probability, useTestSecureRandom))
-            {
-                cout << "\x1B[K\x1B[u";
+            BigInteger start = random(bits - 2, useGenSecureRandom) << 1;
+            start.setBit(bits);
+            start.setBit(0);
+            fill(isComposite.begin(), isComposite.end(), false);
+            // every candidate is at least 2^bits, so a prime below that only divides composites
+            for(size_t i = 0; i < primes.size() && (bits >= 32 || primes[i] < static_cast<uint32_t>(1) << bits); i++)
+            {
+                uint32_t p = primes[i];
+                uint32_t r = static_cast<uint32_t>(start.mod(SmallDivisor(p)));
+                // the first k with start + 2 * k = 0 mod p
+                size_t k = r == 0 ? 0 : r % 2 != 0 ? (p - r) / 2 : (2 * p - r) / 2;
+                for(; k < primeSieveLength; k += p)
+                {
+                    isComposite[k] = true;
+                }
+            }
+            for(size_t k = 0; k < primeSieveLength; k++)
+            {
+                if(isComposite[k])
+                    continue;
+                BigInteger n = start + static_cast<int64_t>(2 * k);
+                if(n.bitLength() > bits + 1)
+                    break;
+                cout << "Testing";
+                for(int i = 0; i < dotCount; i++)
+                    cout << ".";
+                cout << "\x1B[K\r";
                 cout.flush();
-                return n;
+                dotCount %= 10;
+                dotCount++;
+                if(isProbablePrime(n, log2Probability, useTestSecureRandom))
+                {
+                    cout << "\x1B[K\x1B[u";
+                    cout.flush();
+                    return n;
+                }
             }
         }
     }
@@ -1755,15 +3238,13 @@ public:
         BigInteger newR = *this;
         while(!newR.isZero())
         {
-            BigInteger quotient = r / newR;
-            BigInteger temp = t - quotient * newT;
-            t = newT;
-            newT = temp;
-            temp = r - quotient * newR;
+            pair<BigInteger, BigInteger> qr = divMod(r, newR);
+            t.subMul(qr.first, newT);
+            swap(t, newT);
             r = newR;
-            newR = temp;
+            newR = qr.second;
         }
-        if(r > BigInteger(1))
+        if(r > 1)
             throw new domain_error("there is no inverse");
         if(t.sign() < 0)
             t += modulus;
@@ -1805,6 +3286,112 @@ public:
         return x;
     }
 
+private:
+    uint8_t byteAt(size_t index) const
+    {
+        return static_cast<uint8_t>(operator [](index / 4) >> (index % 4 * 8));
+    }
+
+    static void checkWordLayout(int order, size_t wordSize, int endian)
+    {
+        if((order != 1 && order != -1) || wordSize == 0 || endian < -1 || endian > 1)
+        {
+            throw new domain_error("invalid word layout");
+        }
+    }
+
+    static bool isNativeLittleEndian()
+    {
+        const uint32_t v = 1;
+        return *reinterpret_cast<const unsigned char *>(&v) == 1;
+    }
+
+    // position of the byte with significance j in a word of wordSize bytes
+    static size_t byteOffset(size_t j, size_t wordSize, int endian)
+    {
+        if(endian == 0)
+        {
+            endian = (isNativeLittleEndian() ? -1 : 1);
+        }
+        return (endian < 0 ? j : wordSize - 1 - j);
+    }
+public:
+    // order is 1 for most significant word first or -1 for least significant first;
+    // endian is 1 for big endian words, -1 for little endian and 0 for native
+    static const BigInteger importWords(const void * data, size_t count, int order, size_t wordSize, int endian)
+    {
+        checkWordLayout(order, wordSize, endian);
+        const unsigned char * bytes = static_cast<const unsigned char *>(data);
+        size_t byteCount = count * wordSize;
+        BigInteger retval(byteCount / 4 + 1, false);
+        if(order < 0 && byteOffset(1, 2, endian) == 1 && isNativeLittleEndian())
+        {
+            memcpy(retval.digits, bytes, byteCount);
+            retval.normalize();
+            return retval;
+        }
+        for(size_t k = 0; k < count; k++)
+        {
+            const unsigned char * word = bytes + (order < 0 ? k : count - 1 - k) * wordSize;
+            for(size_t j = 0; j < wordSize; j++)
+            {
+                size_t index = k * wordSize + j;
+                retval.digits[index / 4] |= static_cast<uint32_t>(word[byteOffset(j, wordSize, endian)]) << (index % 4 * 8);
+            }
+        }
+        retval.normalize();
+        return retval;
+    }
+
+    size_t exportWordCount(size_t wordSize) const
+    {
+        if(isZero())
+        {
+            return 0;
+        }
+        return ((bitLength() + 7) / 8 + wordSize - 1) / wordSize;
+    }
+
+    // writes exportWordCount(wordSize) words of the magnitude, returns the number of words written
+    size_t exportWords(void * data, int order, size_t wordSize, int endian) const
+    {
+        checkWordLayout(order, wordSize, endian);
+        unsigned char * bytes = static_cast<unsigned char *>(data);
+        size_t count = exportWordCount(wordSize);
+        for(size_t k = 0; k < count; k++)
+        {
+            unsigned char * word = bytes + (order < 0 ? k : count - 1 - k) * wordSize;
+            for(size_t j = 0; j < wordSize; j++)
+            {
+                word[byteOffset(j, wordSize, endian)] = byteAt(k * wordSize + j);
+            }
+        }
+        return count;
+    }
+
+    // I2OSP : big endian, zero padded to exactly length bytes
+    void toFixedBytes(unsigned char * data, size_t length) const
+    {
+        if(isNegative)
+        {
+            throw new domain_error("can't use toFixedBytes on a negative number");
+        }
+        if(!isZero() && (bitLength() + 7) / 8 > length)
+        {
+            throw new length_error("integer too large for toFixedBytes");
+        }
+        for(size_t i = 0, j = length - 1; i < length; i++, j--)
+        {
+            data[j] = byteAt(i);
+        }
+    }
+
+    // OS2IP : big endian
+    static const BigInteger fromBytes(const unsigned char * data, size_t length)
+    {
+        return importWords(data, length, 1, 1, 1);
+    }
+
     string convertToASCII() const
     {
         size_t bitLength = log2(*this);
@@ -1812,29 +3399,146 @@ public:
         {
             throw new domain_error("wrong bit length for convertToASCII");
         }
-        BigInteger v = *this;
-        string retval = "";
-        retval.reserve(bitLength / 8);
-        for(size_t i = 0; i < bitLength / 8; i++)
+        string retval(bitLength / 8, '\0');
+        for(size_t i = 0; i < retval.size(); i++)
         {
-            unsigned char ch = (v & BigInteger(0xFF)).toInt64();
-            retval += ch;
-            v >>= 8;
+            retval[i] = static_cast<char>(byteAt(i));
         }
         return retval;
     }
 
     static BigInteger convertFromASCII(string s)
     {
-        BigInteger retval = BigInteger(1);
-        for(string::const_reverse_iterator i = s.rbegin(); i != s.rend(); i++)
+        BigInteger retval = importWords(s.data(), s.size(), -1, 1, 0);
+        retval.handleWrite(s.size() / 4 + 1);
+        retval.size = s.size() / 4 + 1;
+        retval.digits[s.size() / 4] |= static_cast<uint32_t>(1) << (s.size() % 4 * 8);
+        return retval;
+    }
+
+    explicit BigInteger(const BigIntegerView & v)
+    {
+        isNegative = v.isNegative;
+        size = max<size_t>(v.size, 1);
+        allocated = size;
+        digits = new uint32_t[allocated];
+        digits[0] = 0;
+        memcpy(digits, v.digits, v.size * sizeof(uint32_t));
+        referenceCount = new unsigned(1);
+    }
+
+    // binary format : a little endian uint32_t holding the limb count with the sign in the top bit,
+    // followed by the limbs as little endian uint32_t, least significant first
+    size_t binarySize() const
+    {
+        return 4 * ((isZero() ? 0 : size) + 1);
+    }
+
+    ostream & writeBinary(ostream & os) const
+    {
+        size_t limbCount = (isZero() ? 0 : size);
+        if(limbCount >= 0x80000000U)
         {
-            retval <<= 8;
-            retval += BigInteger((unsigned char)*i);
+            throw new length_error("integer too large for writeBinary");
         }
-        return retval;
+        uint32_t header = static_cast<uint32_t>(limbCount) | (isNegative ? 0x80000000U : 0);
+        unsigned char headerBytes[4];
+        for(size_t i = 0; i < 4; i++)
+        {
+            headerBytes[i] = static_cast<unsigned char>(header >> (i * 8));
+        }
+        os.write(reinterpret_cast<const char *>(headerBytes), 4);
+        if(isNativeLittleEndian())
+        {
+            return os.write(reinterpret_cast<const char *>(digits), 4 * limbCount);
+        }
+        for(size_t i = 0; i < 4 * limbCount; i++)
+        {
+            os.put(static_cast<char>(byteAt(i)));
+        }
+        return os;
+    }
+
+private:
+    // readBinary reads the limbs in chunks of at most this many
+    static const size_t readBinaryChunkLimbs = 1 << 16;
+
+public:
+    // leaves *this unchanged and sets failbit when the stream ends before the limbs its header counts
+    istream & readBinary(istream & is)
+    {
+        unsigned char headerBytes[4];
+        if(!is.read(reinterpret_cast<char *>(headerBytes), 4))
+        {
+            return is;
+        }
+        uint32_t header = 0;
+        for(size_t i = 0; i < 4; i++)
+        {
+            header |= static_cast<uint32_t>(headerBytes[i]) << (i * 8);
+        }
+        size_t limbCount = header & 0x7FFFFFFFU;
+        // the count comes from the stream, so the limbs are read in bounded chunks and the buffer only grows as
+        // they arrive instead of being sized from the header up front
+        vector<uint32_t> limbs;
+        while(limbs.size() < limbCount)
+        {
+            size_t start = limbs.size();
+            size_t chunk = limbCount - start;
+            if(chunk > readBinaryChunkLimbs)
+            {
+                chunk = readBinaryChunkLimbs;
+            }
+            limbs.resize(start + chunk);
+            if(!is.read(reinterpret_cast<char *>(&limbs[start]), 4 * (limbs.size() - start)))
+            {
+                is.setstate(ios::failbit);
+                return is;
+            }
+        }
+        if(!isNativeLittleEndian())
+        {
+            for(size_t i = 0; i < limbCount; i++)
+            {
+                const unsigned char * bytes = reinterpret_cast<const unsigned char *>(&limbs[i]);
+                limbs[i] = static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+            }
+        }
+        if(limbs.empty())
+        {
+            limbs.push_back(0);
+        }
+        BigInteger retval(BigIntegerView(limbs.data(), limbs.size(), (header & 0x80000000U) != 0));
+        retval.normalize();
+        *this = retval;
+        return is;
     }
 };
 
+inline BigIntegerView::BigIntegerView(const BigInteger & v)
+    : digits(v.digits), size(v.isZero() ? 0 : v.size), isNegative(v.isNegative)
+{
+}
+
+inline const BigInteger operator +(const BigIntegerView & a, const BigIntegerView & b)
+{
+    return BigInteger::addSigned(a, b, b.isNegative);
+}
+
+inline const BigInteger operator -(const BigIntegerView & a, const BigIntegerView & b)
+{
+    return BigInteger::addSigned(a, b, !b.isNegative);
+}
+
+inline const BigInteger operator *(const BigIntegerView & a, const BigIntegerView & b)
+{
+    return BigInteger::multiply(a, b);
+}
+
+inline ostream & operator <<(ostream & os, const BigIntegerView & v)
+{
+    return os << BigInteger(v);
+}
+
 
 #endif // BIG_INTEGER_H_INCLUDED
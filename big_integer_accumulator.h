@@ -0,0 +1,140 @@
+#ifndef BIG_INTEGER_ACCUMULATOR_H_INCLUDED
+#define BIG_INTEGER_ACCUMULATOR_H_INCLUDED
+
+#include "big_integer.h"
+
+// sums long streams of BigIntegers and products of them without propagating carries on every step :
+// each 32 bit limb position is a signed 64 bit lane, so an add is the simd addLanes kernel with no carry chain
+// and the carries are resolved once every maxPendingTerms operations and when result() is called
+class BigIntegerAccumulator
+{
+private:
+    vector<int64_t> lanes;
+    vector<uint32_t> product;
+    size_t pendingTerms;
+    // every term adds less than 2^32 to a lane, so lanes stay below 2^62 in magnitude
+    static const size_t maxPendingTerms = static_cast<size_t>(1) << 30;
+
+    // splits v into its low limb and the carry out, rounding the carry down for negative v
+    static uint32_t splitLane(int64_t v, int64_t & carry)
+    {
+        uint32_t low = static_cast<uint32_t>(v);
+        carry = (v - low) / (static_cast<int64_t>(1) << 32);
+        return low;
+    }
+
+    // leaves every lane but the top one in [0, 2^32)
+    void propagateCarries()
+    {
+        int64_t carry = 0;
+        for(size_t i = 0; i < lanes.size(); i++)
+        {
+            lanes[i] = splitLane(lanes[i] + carry, carry);
+        }
+        if(carry != 0)
+        {
+            lanes.push_back(carry);
+        }
+        pendingTerms = 1;
+    }
+
+    void addLimbs(const uint32_t * limbs, size_t count, bool negate)
+    {
+        // a zero term has no limbs, and lanes may still be empty
+        if(count == 0)
+        {
+            return;
+        }
+        if(pendingTerms >= maxPendingTerms)
+        {
+            propagateCarries();
+        }
+        pendingTerms++;
+        if(lanes.size() < count)
+        {
+            lanes.resize(count, 0);
+        }
+        limbKernels().addLanes(&lanes[0], limbs, count, negate);
+    }
+
+public:
+    BigIntegerAccumulator()
+        : pendingTerms(0)
+    {
+    }
+
+    void clear()
+    {
+        lanes.clear();
+        pendingTerms = 0;
+    }
+
+    void add(const BigInteger & v)
+    {
+        BigIntegerView view(v);
+        addLimbs(view.getDigits(), view.getSize(), view.sign() < 0);
+    }
+
+    void sub(const BigInteger & v)
+    {
+        BigIntegerView view(v);
+        addLimbs(view.getDigits(), view.getSize(), view.sign() > 0);
+    }
+
+    // adds a * b; products the kernel multiply handles are written to a reused scratch buffer, not a BigInteger
+    void addProduct(const BigInteger & a, const BigInteger & b)
+    {
+        BigIntegerView x(a), y(b);
+        const BigIntegerView & longer = x.getSize() >= y.getSize() ? x : y;
+        const BigIntegerView & shorter = x.getSize() >= y.getSize() ? y : x;
+        if(shorter.isZero())
+        {
+            return;
+        }
+        bool isNegative = x.sign() != y.sign();
+        const LimbKernels & kernels = limbKernels();
+        if(shorter.getSize() >= kernels.karatsubaThreshold)
+        {
+            BigInteger p = a * b;
+            BigIntegerView view(p);
+            addLimbs(view.getDigits(), view.getSize(), isNegative);
+            return;
+        }
+        size_t count = longer.getSize() + shorter.getSize();
+        if(product.size() < count)
+        {
+            product.resize(count);
+        }
+        kernels.mulN(&product[0], longer.getDigits(), longer.getSize(), shorter.getDigits(), shorter.getSize(), count);
+        addLimbs(&product[0], count, isNegative);
+    }
+
+    const BigInteger result() const
+    {
+        size_t n = lanes.size();
+        vector<uint32_t> limbs(n + 2, 0);
+        int64_t carry = 0;
+        for(size_t i = 0; i < n; i++)
+        {
+            limbs[i] = splitLane(lanes[i] + carry, carry);
+        }
+        if(carry >= 0)
+        {
+            limbs[n] = static_cast<uint32_t>(carry);
+            return BigInteger(BigIntegerView(&limbs[0], n + 2, false));
+        }
+        // the value is limbs - |carry| * 2^(32 * n); negate it as an n limb two's complement number
+        bool isLowZero = true;
+        for(size_t i = 0; i < n; i++)
+        {
+            limbs[i] = ~limbs[i] + (isLowZero ? 1 : 0);
+            isLowZero = isLowZero && limbs[i] == 0;
+        }
+        uint64_t high = 0 - static_cast<uint64_t>(carry) - (isLowZero ? 0 : 1);
+        limbs[n] = static_cast<uint32_t>(high);
+        limbs[n + 1] = static_cast<uint32_t>(high >> 32);
+        return BigInteger(BigIntegerView(&limbs[0], n + 2, true));
+    }
+};
+
+#endif // BIG_INTEGER_ACCUMULATOR_H_INCLUDED
@@ -0,0 +1,186 @@
+#ifndef BIG_INTEGER_ARRAY_H_INCLUDED
+#define BIG_INTEGER_ARRAY_H_INCLUDED
+
+#include "big_integer.h"
+#include <fstream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BIG_INTEGER_ARRAY_USE_MMAP
+#endif
+
+// array file format : the 8 byte magic, the values in BigInteger::writeBinary format,
+// zero padding to a multiple of 8 bytes, a little endian uint64_t file offset for each value,
+// then the little endian uint64_t value count and the uint64_t offset of the offset table
+
+const char bigIntegerArrayMagic[8] = {'B', 'I', 'G', 'I', 'N', 'T', 'A', '1'};
+
+class BigIntegerArrayWriter
+{
+private:
+    ostream & os;
+    vector<uint64_t> offsets;
+    uint64_t position;
+    bool closed;
+    void writeUInt64(uint64_t v)
+    {
+        unsigned char bytes[8];
+        for(size_t i = 0; i < 8; i++)
+        {
+            bytes[i] = static_cast<unsigned char>(v >> (i * 8));
+        }
+        os.write(reinterpret_cast<const char *>(bytes), 8);
+        position += 8;
+    }
+    BigIntegerArrayWriter(const BigIntegerArrayWriter &);
+    const BigIntegerArrayWriter & operator =(const BigIntegerArrayWriter &);
+public:
+    BigIntegerArrayWriter(ostream & os)
+        : os(os), position(sizeof(bigIntegerArrayMagic)), closed(false)
+    {
+        os.write(bigIntegerArrayMagic, sizeof(bigIntegerArrayMagic));
+    }
+    ~BigIntegerArrayWriter()
+    {
+        close();
+    }
+    BigIntegerArrayWriter & add(const BigInteger & v)
+    {
+        if(closed)
+            throw new logic_error("already closed");
+        offsets.push_back(position);
+        v.writeBinary(os);
+        position += v.binarySize();
+        return *this;
+    }
+    void close()
+    {
+        if(closed)
+            return;
+        closed = true;
+        if(position % 8 != 0)
+        {
+            os.write("\0\0\0\0", 4);
+            position += 4;
+        }
+        uint64_t indexOffset = position;
+        for(size_t i = 0; i < offsets.size(); i++)
+        {
+            writeUInt64(offsets[i]);
+        }
+        writeUInt64(offsets.size());
+        writeUInt64(indexOffset);
+        os.flush();
+    }
+};
+
+class MappedBigIntegerArray
+{
+private:
+    const unsigned char * data;
+    size_t length;
+    size_t count;
+    uint64_t indexOffset;
+    static uint64_t readUInt64(const unsigned char * bytes)
+    {
+        uint64_t retval = 0;
+        for(size_t i = 0; i < 8; i++)
+        {
+            retval |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+        }
+        return retval;
+    }
+    void unmap()
+    {
+        if(data == NULL)
+            return;
+#ifdef BIG_INTEGER_ARRAY_USE_MMAP
+        munmap(const_cast<unsigned char *>(data), length);
+#else
+        delete []data;
+#endif
+        data = NULL;
+    }
+    void fail(string fileName, string message)
+    {
+        unmap();
+        throw new runtime_error("can't map '" + fileName + "' : " + message);
+    }
+    MappedBigIntegerArray(const MappedBigIntegerArray &);
+    const MappedBigIntegerArray & operator =(const MappedBigIntegerArray &);
+public:
+    explicit MappedBigIntegerArray(string fileName)
+        : data(NULL), length(0), count(0), indexOffset(0)
+    {
+        const uint32_t one = 1;
+        if(*reinterpret_cast<const unsigned char *>(&one) != 1)
+        {
+            throw new runtime_error("MappedBigIntegerArray needs a little endian host");
+        }
+#ifdef BIG_INTEGER_ARRAY_USE_MMAP
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if(fd < 0)
+            fail(fileName, "can't open file");
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            fail(fileName, "can't get file size");
+        }
+        length = static_cast<size_t>(st.st_size);
+        if(length > 0)
+        {
+            void * mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+            if(mapping != MAP_FAILED)
+                data = static_cast<const unsigned char *>(mapping);
+        }
+        ::close(fd);
+        if(data == NULL)
+            fail(fileName, "mmap failed");
+#else // read the whole file where mmap isn't available
+        ifstream is(fileName.c_str(), ios::binary);
+        if(!is)
+            fail(fileName, "can't open file");
+        is.seekg(0, ios::end);
+        length = static_cast<size_t>(is.tellg());
+        is.seekg(0, ios::beg);
+        unsigned char * buffer = new unsigned char[length];
+        data = buffer;
+        if(!is.read(reinterpret_cast<char *>(buffer), length))
+            fail(fileName, "can't read file");
+#endif
+        if(length < sizeof(bigIntegerArrayMagic) + 16 || memcmp(data, bigIntegerArrayMagic, sizeof(bigIntegerArrayMagic)) != 0)
+            fail(fileName, "not a BigInteger array file");
+        indexOffset = readUInt64(data + length - 8);
+        uint64_t indexCount = readUInt64(data + length - 16);
+        if(indexOffset < sizeof(bigIntegerArrayMagic) || indexOffset > length - 16 || (length - 16 - indexOffset) % 8 != 0 || (length - 16 - indexOffset) / 8 != indexCount)
+            fail(fileName, "corrupt offset table");
+        count = static_cast<size_t>(indexCount);
+    }
+    ~MappedBigIntegerArray()
+    {
+        unmap();
+    }
+    size_t size() const
+    {
+        return count;
+    }
+    BigIntegerView operator [](size_t index) const
+    {
+        if(index >= count)
+            throw new out_of_range("index out of range");
+        uint64_t offset = readUInt64(data + indexOffset + 8 * index);
+        // indexOffset is at least 8, so indexOffset - 4 can't wrap the way offset + 4 could
+        if(offset % 4 != 0 || offset < sizeof(bigIntegerArrayMagic) || offset > indexOffset - 4)
+            throw new runtime_error("corrupt value offset");
+        const uint32_t * record = reinterpret_cast<const uint32_t *>(data + offset);
+        size_t limbCount = record[0] & 0x7FFFFFFFU;
+        if(limbCount > (indexOffset - offset - 4) / 4)
+            throw new runtime_error("corrupt value length");
+        return BigIntegerView(record + 1, limbCount, (record[0] & 0x80000000U) != 0);
+    }
+};
+
+#endif // BIG_INTEGER_ARRAY_H_INCLUDED
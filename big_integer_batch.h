@@ -0,0 +1,129 @@
+#ifndef BIG_INTEGER_BATCH_H_INCLUDED
+#define BIG_INTEGER_BATCH_H_INCLUDED
+
+#include "big_integer.h"
+#include <algorithm>
+#include <thread>
+
+// product and remainder trees : the product of many values and one value modulo many moduli in a balanced tree
+// of multiplications and divisions instead of a quadratic left to right loop. the leaves are sorted by bit length
+// so every multiplication pairs operands of similar size, which is where karatsuba and the simd multiplies pay off.
+// with parallel set, the nodes of each level are spread over the hardware threads
+
+class BigIntegerProductTree
+{
+public:
+    // levels[0] holds the leaves in tree order and every level above holds the products of pairs from the level
+    // below, with an odd node carried up unchanged; the top level is the single product of everything
+    vector<vector<BigInteger> > levels;
+    // levels[0][i] is the value originally at index order[i]
+    vector<size_t> order;
+    const BigInteger & product() const
+    {
+        return levels.back()[0];
+    }
+};
+
+// runs task(i) for every i in [0, count), spread over the hardware threads when parallel is set
+template <typename Task>
+void batchForEach(size_t count, bool parallel, const Task & task)
+{
+    size_t threadCount = parallel ? min<size_t>(count, thread::hardware_concurrency()) : 1;
+    if(threadCount <= 1)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+    vector<thread> threads;
+    for(size_t t = 0; t < threadCount; t++)
+    {
+        threads.push_back(thread([&task, t, threadCount, count]()
+        {
+            for(size_t i = t; i < count; i += threadCount)
+            {
+                task(i);
+            }
+        }));
+    }
+    for(size_t t = 0; t < threadCount; t++)
+    {
+        threads[t].join();
+    }
+}
+
+inline const BigIntegerProductTree productTree(const vector<BigInteger> & values, bool parallel = false)
+{
+    BigIntegerProductTree tree;
+    tree.order.resize(values.size());
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        tree.order[i] = i;
+    }
+    stable_sort(tree.order.begin(), tree.order.end(), [&values](size_t a, size_t b)
+    {
+        return values[a].bitLength() < values[b].bitLength();
+    });
+    tree.levels.push_back(vector<BigInteger>());
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        tree.levels[0].push_back(values[tree.order[i]]);
+    }
+    if(values.empty())
+    {
+        tree.levels[0].push_back(BigInteger(1));
+    }
+    while(tree.levels.back().size() > 1)
+    {
+        const vector<BigInteger> & below = tree.levels.back();
+        vector<BigInteger> level((below.size() + 1) / 2);
+        batchForEach(below.size() / 2, parallel, [&below, &level](size_t i)
+        {
+            level[i] = below[2 * i] * below[2 * i + 1];
+        });
+        if(below.size() % 2 != 0)
+        {
+            level.back() = below.back();
+        }
+        tree.levels.push_back(level);
+    }
+    return tree;
+}
+
+// the product of all the values, 1 for none
+inline const BigInteger product(const vector<BigInteger> & values, bool parallel = false)
+{
+    return productTree(values, parallel).product();
+}
+
+// n % leaf for every leaf of the tree, in the original order of the values; the remainders truncate like %
+inline const vector<BigInteger> remainderTree(const BigInteger & n, const BigIntegerProductTree & tree, bool parallel = false)
+{
+    vector<BigInteger> remainders(1, n % tree.product());
+    for(size_t l = tree.levels.size() - 1; l > 0; l--)
+    {
+        const vector<BigInteger> & level = tree.levels[l - 1];
+        vector<BigInteger> next(level.size());
+        batchForEach(level.size(), parallel, [&level, &next, &remainders](size_t i)
+        {
+            next[i] = remainders[i / 2] % level[i];
+        });
+        remainders.swap(next);
+    }
+    vector<BigInteger> retval(tree.order.size());
+    for(size_t i = 0; i < tree.order.size(); i++)
+    {
+        retval[tree.order[i]] = remainders[i];
+    }
+    return retval;
+}
+
+// n % moduli[i] for every i
+inline const vector<BigInteger> batchMod(const BigInteger & n, const vector<BigInteger> & moduli, bool parallel = false)
+{
+    return remainderTree(n, productTree(moduli, parallel), parallel);
+}
+
+#endif // BIG_INTEGER_BATCH_H_INCLUDED
@@ -0,0 +1,186 @@
+#ifndef BIG_INTEGER_CRT_H_INCLUDED
+#define BIG_INTEGER_CRT_H_INCLUDED
+
+#include "big_integer_batch.h"
+
+// chinese remainder reconstruction for pairwise coprime word sized moduli. the constructor builds the product tree
+// of the moduli and c[i] = (M / m[i])^-1 mod m[i] once, where M is the product of the moduli : M mod m[i]^2 comes down
+// a remainder tree over the squared nodes, and dividing it by m[i] gives M / m[i] mod m[i].
+// reconstruct then finds x = sum((r[i] * c[i] mod m[i]) * M / m[i]) mod M by combining up the same tree,
+// each node being left * product(right) + right * product(left), so it takes quasi-linear time
+class CRTContext
+{
+private:
+    BigIntegerProductTree tree;
+    vector<uint64_t> moduli;
+    vector<SmallDivisor> divisors;
+    vector<uint64_t> inverses;
+    bool parallel;
+    // residues() leaves the remainder tree at nodes of 2^directLevel moduli
+    static const size_t directLevel = 5;
+
+    // the BigInteger(int64_t) constructor would take words of 2^63 and up as negative
+    static const BigInteger fromWord(uint64_t v)
+    {
+        uint32_t limbs[2] = {static_cast<uint32_t>(v), static_cast<uint32_t>(v >> 32)};
+        return BigInteger(BigIntegerView(limbs, 2, false));
+    }
+
+    // a^-1 mod m by the extended euclidean algorithm; the coefficient signs alternate, so only magnitudes are kept
+    static uint64_t inverseMod(uint64_t a, uint64_t m)
+    {
+        uint64_t r0 = m, r1 = a % m, t0 = 0, t1 = 1;
+        // t1 is positive, so t0 is negative after the first step
+        bool isT0Negative = true;
+        while(r1 != 0)
+        {
+            uint64_t q = r0 / r1, r = r0 - q * r1, t = t0 + q * t1;
+            r0 = r1;
+            r1 = r;
+            t0 = t1;
+            t1 = t;
+            isT0Negative = !isT0Negative;
+        }
+        if(r0 != 1)
+        {
+            throw new domain_error("the moduli of a CRTContext must be pairwise coprime");
+        }
+        return isT0Negative ? m - t0 : t0;
+    }
+
+public:
+    explicit CRTContext(const vector<uint64_t> & m, bool parallel = false)
+        : moduli(m), parallel(parallel)
+    {
+        vector<BigInteger> values;
+        for(size_t i = 0; i < m.size(); i++)
+        {
+            if(m[i] < 2)
+            {
+                throw new domain_error("the moduli of a CRTContext must be at least 2");
+            }
+            divisors.push_back(SmallDivisor(m[i]));
+            values.push_back(fromWord(m[i]));
+        }
+        tree = productTree(values, parallel);
+        // M mod node^2 down the tree
+        vector<BigInteger> remainders(1, tree.product());
+        for(size_t l = tree.levels.size() - 1; l > 0; l--)
+        {
+            const vector<BigInteger> & level = tree.levels[l - 1];
+            vector<BigInteger> next(level.size());
+            batchForEach(level.size(), parallel, [&level, &next, &remainders](size_t i)
+            {
+                next[i] = remainders[i / 2] % (level[i] * level[i]);
+            });
+            remainders.swap(next);
+        }
+        inverses.resize(m.size());
+        for(size_t j = 0; j < m.size(); j++)
+        {
+            size_t i = tree.order[j];
+            uint64_t cofactor = (remainders[j] / tree.levels[0][j]).mod(divisors[i]);
+            inverses[i] = inverseMod(cofactor, m[i]);
+        }
+    }
+
+    // the product of the moduli
+    const BigInteger & modulus() const
+    {
+        return tree.product();
+    }
+
+    const vector<uint64_t> & getModuli() const
+    {
+        return moduli;
+    }
+
+    const SmallDivisor & getDivisor(size_t index) const
+    {
+        return divisors[index];
+    }
+
+    bool isParallel() const
+    {
+        return parallel;
+    }
+
+    // n mod m[i] in [0, m[i]) for every modulus, down the remainder tree of the moduli. a node is only divided by
+    // when the remainder from above is at least as long as it, and the tree stops directLevel levels above the leaves,
+    // where the word sized divisors finish the remainders faster than more levels of long division
+    const vector<uint64_t> residues(const BigInteger & n) const
+    {
+        size_t cut = tree.levels.size() - 1 < directLevel ? tree.levels.size() - 1 : directLevel;
+        vector<BigInteger> remainders(1, divMod(n, modulus(), Rounding::Floor).second);
+        for(size_t l = tree.levels.size() - 1; l > cut; l--)
+        {
+            const vector<BigInteger> & level = tree.levels[l - 1];
+            vector<BigInteger> next(level.size());
+            batchForEach(level.size(), parallel, [&level, &next, &remainders](size_t i)
+            {
+                if(remainders[i / 2].bitLength() >= level[i].bitLength())
+                {
+                    next[i] = remainders[i / 2] % level[i];
+                }
+            });
+            // the copies share the limbs of the parent, so they are made outside the threads
+            for(size_t i = 0; i < level.size(); i++)
+            {
+                if(remainders[i / 2].bitLength() < level[i].bitLength())
+                {
+                    next[i] = remainders[i / 2];
+                }
+            }
+            remainders.swap(next);
+        }
+        vector<uint64_t> retval(moduli.size());
+        batchForEach(moduli.size(), parallel, [this, &retval, &remainders, cut](size_t j)
+        {
+            retval[tree.order[j]] = remainders[j >> cut].mod(divisors[tree.order[j]]);
+        });
+        return retval;
+    }
+
+    // the x in [0, M) with x = residues[i] mod m[i], or in (-M / 2, M / 2] if isSigned is set
+    const BigInteger reconstruct(const vector<uint64_t> & residues, bool isSigned = false) const
+    {
+        if(residues.size() != moduli.size())
+        {
+            throw new domain_error("CRTContext::reconstruct needs one residue per modulus");
+        }
+        vector<BigInteger> sums(moduli.size());
+        for(size_t j = 0; j < moduli.size(); j++)
+        {
+            size_t i = tree.order[j];
+            const SmallDivisor & m = divisors[i];
+            sums[j] = fromWord(m.mulMod(residues[i] % m.getDivisor(), inverses[i]));
+        }
+        if(sums.empty())
+        {
+            return BigInteger(0);
+        }
+        for(size_t l = 1; l < tree.levels.size(); l++)
+        {
+            const vector<BigInteger> & below = tree.levels[l - 1];
+            vector<BigInteger> next((sums.size() + 1) / 2);
+            batchForEach(sums.size() / 2, parallel, [&below, &sums, &next](size_t i)
+            {
+                next[i] = sums[2 * i] * below[2 * i + 1];
+                next[i].addMul(sums[2 * i + 1], below[2 * i]);
+            });
+            if(sums.size() % 2 != 0)
+            {
+                next.back() = sums.back();
+            }
+            sums.swap(next);
+        }
+        BigInteger retval = sums[0] % modulus();
+        if(isSigned && (retval << 1) > modulus())
+        {
+            retval -= modulus();
+        }
+        return retval;
+    }
+};
+
+#endif // BIG_INTEGER_CRT_H_INCLUDED
@@ -0,0 +1,484 @@
+#ifndef BIG_INTEGER_EXPRESSION_H_INCLUDED
+#define BIG_INTEGER_EXPRESSION_H_INCLUDED
+
+#include "big_integer.h"
+
+// opt in lazy evaluation : lazy(v) wraps a BigInteger, and + - * on wrapped values only record the expression tree.
+// assigning the tree to a BigInteger evaluates it in one go : the destination is sized once from the operand sizes,
+// sums of products go through addMul / subMul and the result is written into the destination's own limbs.
+// an expression holds references to its BigInteger operands, so it must not outlive them; native integer operands
+// and temporary BigIntegers such as lazy(a) * (b + c) are kept by value, and lazy() of a temporary is rejected.
+//
+//     x = lazy(a) * b - lazy(c) * d;
+
+// the parts of BigInteger the evaluator writes through
+struct BigIntegerExpressionAccess
+{
+    static size_t limbCount(const BigInteger & v)
+    {
+        return v.size;
+    }
+
+    // makes v zero and unshared with room for limbCount limbs, keeping its buffer when that is big enough
+    static void clear(BigInteger & v, size_t limbCount)
+    {
+        if(*v.referenceCount > 1 || v.allocated < limbCount)
+        {
+            v = BigInteger(limbCount, false);
+        }
+        v.size = 1;
+        v.digits[0] = 0;
+        v.isNegative = false;
+    }
+
+    // makes v unshared with room for it to grow to limbCount limbs plus a carry
+    static void reserve(BigInteger & v, size_t limbCount)
+    {
+        v.handleWrite(max(v.size, limbCount) + 1);
+    }
+
+    // dest = v; dest must be unshared and must not be v
+    static void assign(BigInteger & dest, const BigInteger & v)
+    {
+        dest.handleWrite(v.size);
+        memcpy(dest.digits, v.digits, v.size * sizeof(uint32_t));
+        dest.size = v.size;
+        dest.isNegative = v.isNegative;
+    }
+
+    template <typename T>
+    static const BigInteger fromNative(T v)
+    {
+        uint32_t limbs[2];
+        return BigInteger(BigInteger::nativeView(v, limbs));
+    }
+
+    static void negate(BigInteger & v)
+    {
+        v.isNegative = !v.isNegative && !v.isZero();
+    }
+
+    // dest = a * b, written straight into the limbs of dest when the kernel multiply handles the sizes;
+    // dest must be unshared and must not be a or b
+    static void multiply(BigInteger & dest, const BigInteger & a, const BigInteger & b)
+    {
+        const BigInteger & longer = a.size >= b.size ? a : b;
+        const BigInteger & shorter = a.size >= b.size ? b : a;
+        const LimbKernels & kernels = limbKernels();
+        if(shorter.size >= kernels.karatsubaThreshold)
+        {
+            dest = a * b;
+            return;
+        }
+        size_t count = longer.size + shorter.size;
+        dest.handleWrite(count);
+        kernels.mulN(dest.digits, longer.digits, longer.size, shorter.digits, shorter.size, count);
+        dest.size = count;
+        dest.isNegative = a.isNegative != b.isNegative;
+        dest.normalize();
+    }
+};
+
+template <typename Derived>
+class BigIntegerExpression
+{
+public:
+    const Derived & derived() const
+    {
+        return static_cast<const Derived &>(*this);
+    }
+
+    // dest = the expression; goes through a temporary only when dest is one of the operands
+    void assignTo(BigInteger & dest) const
+    {
+        if(derived().refersTo(dest))
+        {
+            BigInteger retval;
+            assignTo(retval);
+            dest = retval;
+            return;
+        }
+        BigIntegerExpressionAccess::clear(dest, derived().limbBound() + 1);
+        derived().evaluateInto(dest);
+    }
+
+    // dest += the expression, or dest -= it if negate is set
+    void addTo(BigInteger & dest, bool negate) const
+    {
+        if(derived().refersTo(dest))
+        {
+            BigInteger v(*this);
+            if(negate)
+            {
+                dest -= v;
+            }
+            else
+            {
+                dest += v;
+            }
+            return;
+        }
+        BigIntegerExpressionAccess::reserve(dest, derived().limbBound());
+        derived().accumulateInto(dest, negate);
+    }
+};
+
+class BigIntegerTerminal : public BigIntegerExpression<BigIntegerTerminal>
+{
+private:
+    const BigInteger & value;
+public:
+    explicit BigIntegerTerminal(const BigInteger & value)
+        : value(value)
+    {
+    }
+    const BigInteger & getValue() const
+    {
+        return value;
+    }
+    size_t limbBound() const
+    {
+        return BigIntegerExpressionAccess::limbCount(value);
+    }
+    bool refersTo(const BigInteger & v) const
+    {
+        return &v == &value;
+    }
+    void evaluateInto(BigInteger & dest) const
+    {
+        BigIntegerExpressionAccess::assign(dest, value);
+    }
+    void accumulateInto(BigInteger & dest, bool negate) const
+    {
+        if(negate)
+        {
+            dest -= value;
+        }
+        else
+        {
+            dest += value;
+        }
+    }
+};
+
+// a native integer or temporary BigInteger operand; it would be gone before the expression is evaluated,
+// so the terminal keeps its own copy of the value
+class BigIntegerValueTerminal : public BigIntegerExpression<BigIntegerValueTerminal>
+{
+private:
+    BigInteger value;
+public:
+    template <typename T>
+    explicit BigIntegerValueTerminal(T value, typename enable_if<isNativeInteger<T>::value>::type * = NULL)
+        : value(BigIntegerExpressionAccess::fromNative(value))
+    {
+    }
+    // shares the limbs of value, so this is not a deep copy
+    explicit BigIntegerValueTerminal(const BigInteger & value)
+        : value(value)
+    {
+    }
+    const BigInteger & getValue() const
+    {
+        return value;
+    }
+    size_t limbBound() const
+    {
+        return BigIntegerExpressionAccess::limbCount(value);
+    }
+    bool refersTo(const BigInteger &) const
+    {
+        return false;
+    }
+    void evaluateInto(BigInteger & dest) const
+    {
+        BigIntegerExpressionAccess::assign(dest, value);
+    }
+    void accumulateInto(BigInteger & dest, bool negate) const
+    {
+        if(negate)
+        {
+            dest -= value;
+        }
+        else
+        {
+            dest += value;
+        }
+    }
+};
+
+// the terminal for a BigInteger or native integer operand next to an expression; other types, including anything
+// that would only become a BigInteger through a temporary, have none
+template <typename T, typename Enable = void>
+struct BigIntegerTerminalOf
+{
+};
+
+template <>
+struct BigIntegerTerminalOf<BigInteger>
+{
+    typedef BigIntegerTerminal type;
+};
+
+template <typename T>
+struct BigIntegerTerminalOf<T, typename enable_if<isNativeInteger<T>::value>::type>
+{
+    typedef BigIntegerValueTerminal type;
+};
+
+// an operand of a product : a terminal is used in place, anything else is evaluated into storage first
+template <typename E>
+struct BigIntegerOperand
+{
+    BigInteger storage;
+    const BigInteger & value;
+    explicit BigIntegerOperand(const E & e)
+        : storage(), value(storage)
+    {
+        e.assignTo(storage);
+    }
+};
+
+template <>
+struct BigIntegerOperand<BigIntegerTerminal>
+{
+    const BigInteger & value;
+    explicit BigIntegerOperand(const BigIntegerTerminal & e)
+        : value(e.getValue())
+    {
+    }
+};
+
+template <>
+struct BigIntegerOperand<BigIntegerValueTerminal>
+{
+    const BigInteger & value;
+    explicit BigIntegerOperand(const BigIntegerValueTerminal & e)
+        : value(e.getValue())
+    {
+    }
+};
+
+template <typename L, typename R>
+class BigIntegerSum : public BigIntegerExpression<BigIntegerSum<L, R> >
+{
+private:
+    L left;
+    R right;
+    bool isSubtraction;
+public:
+    BigIntegerSum(const L & left, const R & right, bool isSubtraction)
+        : left(left), right(right), isSubtraction(isSubtraction)
+    {
+    }
+    size_t limbBound() const
+    {
+        return max(left.limbBound(), right.limbBound()) + 1;
+    }
+    bool refersTo(const BigInteger & v) const
+    {
+        return left.refersTo(v) || right.refersTo(v);
+    }
+    void evaluateInto(BigInteger & dest) const
+    {
+        left.evaluateInto(dest);
+        right.accumulateInto(dest, isSubtraction);
+    }
+    void accumulateInto(BigInteger & dest, bool negate) const
+    {
+        left.accumulateInto(dest, negate);
+        right.accumulateInto(dest, negate != isSubtraction);
+    }
+};
+
+template <typename L, typename R>
+class BigIntegerProduct : public BigIntegerExpression<BigIntegerProduct<L, R> >
+{
+private:
+    L left;
+    R right;
+public:
+    BigIntegerProduct(const L & left, const R & right)
+        : left(left), right(right)
+    {
+    }
+    size_t limbBound() const
+    {
+        return left.limbBound() + right.limbBound();
+    }
+    bool refersTo(const BigInteger & v) const
+    {
+        return left.refersTo(v) || right.refersTo(v);
+    }
+    void evaluateInto(BigInteger & dest) const
+    {
+        BigIntegerOperand<L> a(left);
+        BigIntegerOperand<R> b(right);
+        BigIntegerExpressionAccess::multiply(dest, a.value, b.value);
+    }
+    // the fused multiply add : no temporary for the product when an operand is short
+    void accumulateInto(BigInteger & dest, bool negate) const
+    {
+        BigIntegerOperand<L> a(left);
+        BigIntegerOperand<R> b(right);
+        if(negate)
+        {
+            dest.subMul(a.value, b.value);
+        }
+        else
+        {
+            dest.addMul(a.value, b.value);
+        }
+    }
+};
+
+template <typename E>
+class BigIntegerNegation : public BigIntegerExpression<BigIntegerNegation<E> >
+{
+private:
+    E operand;
+public:
+    explicit BigIntegerNegation(const E & operand)
+        : operand(operand)
+    {
+    }
+    size_t limbBound() const
+    {
+        return operand.limbBound();
+    }
+    bool refersTo(const BigInteger & v) const
+    {
+        return operand.refersTo(v);
+    }
+    void evaluateInto(BigInteger & dest) const
+    {
+        operand.evaluateInto(dest);
+        BigIntegerExpressionAccess::negate(dest);
+    }
+    void accumulateInto(BigInteger & dest, bool negate) const
+    {
+        operand.accumulateInto(dest, !negate);
+    }
+};
+
+inline const BigIntegerTerminal lazy(const BigInteger & v)
+{
+    return BigIntegerTerminal(v);
+}
+
+// a temporary would be gone before the expression is evaluated
+const BigIntegerTerminal lazy(const BigInteger && v) = delete;
+
+template <typename L, typename R>
+const BigIntegerSum<L, R> operator +(const BigIntegerExpression<L> & l, const BigIntegerExpression<R> & r)
+{
+    return BigIntegerSum<L, R>(l.derived(), r.derived(), false);
+}
+
+template <typename L, typename T>
+const BigIntegerSum<L, typename BigIntegerTerminalOf<T>::type> operator +(const BigIntegerExpression<L> & l, const T & r)
+{
+    typedef typename BigIntegerTerminalOf<T>::type Terminal;
+    return BigIntegerSum<L, Terminal>(l.derived(), Terminal(r), false);
+}
+
+template <typename T, typename R>
+const BigIntegerSum<typename BigIntegerTerminalOf<T>::type, R> operator +(const T & l, const BigIntegerExpression<R> & r)
+{
+    typedef typename BigIntegerTerminalOf<T>::type Terminal;
+    return BigIntegerSum<Terminal, R>(Terminal(l), r.derived(), false);
+}
+
+// a temporary BigInteger operand is kept by value rather than referred to; the template keeps other types from
+// converting to a temporary BigInteger here
+template <typename L, typename T>
+typename enable_if<is_same<T, BigInteger>::value, const BigIntegerSum<L, BigIntegerValueTerminal>>::type
+    operator +(const BigIntegerExpression<L> & l, const T && r)
+{
+    return BigIntegerSum<L, BigIntegerValueTerminal>(l.derived(), BigIntegerValueTerminal(r), false);
+}
+
+template <typename T, typename R>
+typename enable_if<is_same<T, BigInteger>::value, const BigIntegerSum<BigIntegerValueTerminal, R>>::type
+    operator +(const T && l, const BigIntegerExpression<R> & r)
+{
+    return BigIntegerSum<BigIntegerValueTerminal, R>(BigIntegerValueTerminal(l), r.derived(), false);
+}
+
+template <typename L, typename R>
+const BigIntegerSum<L, R> operator -(const BigIntegerExpression<L> & l, const BigIntegerExpression<R> & r)
+{
+    return BigIntegerSum<L, R>(l.derived(), r.derived(), true);
+}
+
+template <typename L, typename T>
+const BigIntegerSum<L, typename BigIntegerTerminalOf<T>::type> operator -(const BigIntegerExpression<L> & l, const T & r)
+{
+    typedef typename BigIntegerTerminalOf<T>::type Terminal;
+    return BigIntegerSum<L, Terminal>(l.derived(), Terminal(r), true);
+}
+
+template <typename T, typename R>
+const BigIntegerSum<typename BigIntegerTerminalOf<T>::type, R> operator -(const T & l, const BigIntegerExpression<R> & r)
+{
+    typedef typename BigIntegerTerminalOf<T>::type Terminal;
+    return BigIntegerSum<Terminal, R>(Terminal(l), r.derived(), true);
+}
+
+// a temporary BigInteger operand is kept by value rather than referred to
+template <typename L, typename T>
+typename enable_if<is_same<T, BigInteger>::value, const BigIntegerSum<L, BigIntegerValueTerminal>>::type
+    operator -(const BigIntegerExpression<L> & l, const T && r)
+{
+    return BigIntegerSum<L, BigIntegerValueTerminal>(l.derived(), BigIntegerValueTerminal(r), true);
+}
+
+template <typename T, typename R>
+typename enable_if<is_same<T, BigInteger>::value, const BigIntegerSum<BigIntegerValueTerminal, R>>::type
+    operator -(const T && l, const BigIntegerExpression<R> & r)
+{
+    return BigIntegerSum<BigIntegerValueTerminal, R>(BigIntegerValueTerminal(l), r.derived(), true);
+}
+
+template <typename L, typename R>
+const BigIntegerProduct<L, R> operator *(const BigIntegerExpression<L> & l, const BigIntegerExpression<R> & r)
+{
+    return BigIntegerProduct<L, R>(l.derived(), r.derived());
+}
+
+template <typename L, typename T>
+const BigIntegerProduct<L, typename BigIntegerTerminalOf<T>::type> operator *(const BigIntegerExpression<L> & l, const T & r)
+{
+    typedef typename BigIntegerTerminalOf<T>::type Terminal;
+    return BigIntegerProduct<L, Terminal>(l.derived(), Terminal(r));
+}
+
+template <typename T, typename R>
+const BigIntegerProduct<typename BigIntegerTerminalOf<T>::type, R> operator *(const T & l, const BigIntegerExpression<R> & r)
+{
+    typedef typename BigIntegerTerminalOf<T>::type Terminal;
+    return BigIntegerProduct<Terminal, R>(Terminal(l), r.derived());
+}
+
+// a temporary BigInteger operand is kept by value rather than referred to
+template <typename L, typename T>
+typename enable_if<is_same<T, BigInteger>::value, const BigIntegerProduct<L, BigIntegerValueTerminal>>::type
+    operator *(const BigIntegerExpression<L> & l, const T && r)
+{
+    return BigIntegerProduct<L, BigIntegerValueTerminal>(l.derived(), BigIntegerValueTerminal(r));
+}
+
+template <typename T, typename R>
+typename enable_if<is_same<T, BigInteger>::value, const BigIntegerProduct<BigIntegerValueTerminal, R>>::type
+    operator *(const T && l, const BigIntegerExpression<R> & r)
+{
+    return BigIntegerProduct<BigIntegerValueTerminal, R>(BigIntegerValueTerminal(l), r.derived());
+}
+
+template <typename E>
+const BigIntegerNegation<E> operator -(const BigIntegerExpression<E> & e)
+{
+    return BigIntegerNegation<E>(e.derived());
+}
+
+#endif // BIG_INTEGER_EXPRESSION_H_INCLUDED
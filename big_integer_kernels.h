@@ -0,0 +1,507 @@
+#ifndef BIG_INTEGER_KERNELS_H_INCLUDED
+#define BIG_INTEGER_KERNELS_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(BIG_INTEGER_NO_ASM)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define BIG_INTEGER_USE_X86_64_KERNELS
+#ifndef BIG_INTEGER_NO_SIMD
+#define BIG_INTEGER_USE_SIMD_KERNELS
+#endif
+#endif
+
+using namespace std;
+
+// limb loop kernels over little endian uint32_t limb arrays, in the style of the gmp mpn layer :
+// addN : r = a + b, returns the carry
+// subN : r = a - b, returns the borrow
+// mul1 : r = a * m, returns the high limb
+// addMul1 : r += a * m, returns the high limb
+// subMul1 : r -= a * m, returns the high limb that still has to be subtracted
+// r may equal a (and b) but must not partially overlap them
+// mulN : r = the low rn limbs of a * b, rn <= na + nb; r must not overlap a or b
+// addLanes : lanes[i] += a[i] (or -= when negate is set) on signed 64 bit lanes, with no carries between them
+// karatsubaThreshold : the operand size in limbs where karatsuba starts to beat mulN
+struct LimbKernels
+{
+    uint32_t (*addN)(uint32_t * r, const uint32_t * a, const uint32_t * b, size_t n);
+    uint32_t (*subN)(uint32_t * r, const uint32_t * a, const uint32_t * b, size_t n);
+    uint32_t (*mul1)(uint32_t * r, const uint32_t * a, size_t n, uint32_t m);
+    uint32_t (*addMul1)(uint32_t * r, const uint32_t * a, size_t n, uint32_t m);
+    uint32_t (*subMul1)(uint32_t * r, const uint32_t * a, size_t n, uint32_t m);
+    void (*mulN)(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb, size_t rn);
+    void (*addLanes)(int64_t * lanes, const uint32_t * a, size_t n, bool negate);
+    size_t karatsubaThreshold;
+    const char * name;
+};
+
+inline uint32_t portableAddN(uint32_t * r, const uint32_t * a, const uint32_t * b, size_t n)
+{
+    uint64_t carry = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        carry += static_cast<uint64_t>(a[i]) + b[i];
+        r[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline uint32_t portableSubN(uint32_t * r, const uint32_t * a, const uint32_t * b, size_t n)
+{
+    uint32_t borrow = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        uint64_t difference = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+        r[i] = static_cast<uint32_t>(difference);
+        borrow = static_cast<uint32_t>(difference >> 63);
+    }
+    return borrow;
+}
+
+inline uint32_t portableMul1(uint32_t * r, const uint32_t * a, size_t n, uint32_t m)
+{
+    uint64_t carry = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        carry += static_cast<uint64_t>(a[i]) * m;
+        r[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline uint32_t portableAddMul1(uint32_t * r, const uint32_t * a, size_t n, uint32_t m)
+{
+    uint64_t carry = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        carry += static_cast<uint64_t>(a[i]) * m + r[i];
+        r[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline uint32_t portableSubMul1(uint32_t * r, const uint32_t * a, size_t n, uint32_t m)
+{
+    uint64_t carry = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        carry += static_cast<uint64_t>(a[i]) * m;
+        uint32_t v = r[i];
+        r[i] = v - static_cast<uint32_t>(carry);
+        carry = (carry >> 32) + (v < static_cast<uint32_t>(carry));
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+template <uint32_t (*addMul1)(uint32_t *, const uint32_t *, size_t, uint32_t)>
+void schoolbookMulN(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb, size_t rn)
+{
+    for(size_t i = 0; i < rn; i++)
+    {
+        r[i] = 0;
+    }
+    for(size_t j = 0; j < nb && j < rn; j++)
+    {
+        size_t count = min(na, rn - j);
+        uint32_t carry = addMul1(r + j, a, count, b[j]);
+        if(j + count < rn)
+        {
+            r[j + count] = carry;
+        }
+    }
+}
+
+inline void portableAddLanes(int64_t * lanes, const uint32_t * a, size_t n, bool negate)
+{
+    if(negate)
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            lanes[i] -= a[i];
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            lanes[i] += a[i];
+        }
+    }
+}
+
+#ifdef BIG_INTEGER_USE_X86_64_KERNELS
+// the x86-64 kernels work on pairs of limbs as one 64 bit word and finish an odd limb count with one 32 bit step
+
+inline uint64_t loadWord(const uint32_t * p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void storeWord(uint32_t * p, uint64_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+inline uint32_t x86AddN(uint32_t * r, const uint32_t * a, const uint32_t * b, size_t n)
+{
+    unsigned char carry = 0;
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        unsigned long long sum;
+        carry = _addcarry_u64(carry, loadWord(a + i), loadWord(b + i), &sum);
+        storeWord(r + i, sum);
+    }
+    if(i < n)
+    {
+        uint64_t sum = static_cast<uint64_t>(a[i]) + b[i] + carry;
+        r[i] = static_cast<uint32_t>(sum);
+        carry = static_cast<unsigned char>(sum >> 32);
+    }
+    return carry;
+}
+
+inline uint32_t x86SubN(uint32_t * r, const uint32_t * a, const uint32_t * b, size_t n)
+{
+    unsigned char borrow = 0;
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        unsigned long long difference;
+        borrow = _subborrow_u64(borrow, loadWord(a + i), loadWord(b + i), &difference);
+        storeWord(r + i, difference);
+    }
+    if(i < n)
+    {
+        uint64_t difference = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+        r[i] = static_cast<uint32_t>(difference);
+        borrow = static_cast<unsigned char>(difference >> 63);
+    }
+    return borrow;
+}
+
+__attribute__((target("bmi2"))) inline uint32_t x86Mul1(uint32_t * r, const uint32_t * a, size_t n, uint32_t m)
+{
+    uint64_t carry = 0;
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        unsigned long long high;
+        uint64_t low = _mulx_u64(loadWord(a + i), m, &high);
+        low += carry;
+        carry = high + (low < carry);
+        storeWord(r + i, low);
+    }
+    if(i < n)
+    {
+        carry += static_cast<uint64_t>(a[i]) * m;
+        r[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+// r[0, wordCount) += a[0, wordCount) * m over 64 bit words with two independent carry chains :
+// adcx folds the previous high word into the low product, adox adds that into r
+__attribute__((target("bmi2,adx"))) inline uint64_t x86AddMulWords(uint32_t * r, const uint32_t * a, size_t wordCount, uint64_t m)
+{
+    uint64_t carry;
+    __asm__ __volatile__(
+        "xor %k[carry], %k[carry]\n\t"
+        "1:\n\t"
+        "mulx (%[a]), %%r8, %%r9\n\t"
+        "adcx %[carry], %%r8\n\t"
+        "adox (%[r]), %%r8\n\t"
+        "mov %%r8, (%[r])\n\t"
+        "mov %%r9, %[carry]\n\t"
+        "lea 8(%[a]), %[a]\n\t"
+        "lea 8(%[r]), %[r]\n\t"
+        "lea -1(%[n]), %[n]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %%r8d\n\t"
+        "adcx %%r8, %[carry]\n\t"
+        "adox %%r8, %[carry]\n\t"
+        : [carry] "=&r"(carry), [a] "+r"(a), [r] "+r"(r), [n] "+c"(wordCount)
+        : "d"(m)
+        : "r8", "r9", "cc", "memory");
+    return carry;
+}
+
+// same as x86AddMulWords but subtracts, using r - x == ~(~r + x) so the adox chain carries the borrow
+__attribute__((target("bmi2,adx"))) inline uint64_t x86SubMulWords(uint32_t * r, const uint32_t * a, size_t wordCount, uint64_t m)
+{
+    uint64_t carry;
+    __asm__ __volatile__(
+        "xor %k[carry], %k[carry]\n\t"
+        "1:\n\t"
+        "mulx (%[a]), %%r8, %%r9\n\t"
+        "adcx %[carry], %%r8\n\t"
+        "mov (%[r]), %%r10\n\t"
+        "not %%r10\n\t"
+        "adox %%r8, %%r10\n\t"
+        "not %%r10\n\t"
+        "mov %%r10, (%[r])\n\t"
+        "mov %%r9, %[carry]\n\t"
+        "lea 8(%[a]), %[a]\n\t"
+        "lea 8(%[r]), %[r]\n\t"
+        "lea -1(%[n]), %[n]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %%r8d\n\t"
+        "adcx %%r8, %[carry]\n\t"
+        "adox %%r8, %[carry]\n\t"
+        : [carry] "=&r"(carry), [a] "+r"(a), [r] "+r"(r), [n] "+c"(wordCount)
+        : "d"(m)
+        : "r8", "r9", "r10", "cc", "memory");
+    return carry;
+}
+
+inline uint32_t x86AddMul1(uint32_t * r, const uint32_t * a, size_t n, uint32_t m)
+{
+    uint64_t carry = 0;
+    size_t wordCount = n / 2;
+    if(wordCount > 0)
+    {
+        carry = x86AddMulWords(r, a, wordCount, m);
+    }
+    if(n % 2 != 0)
+    {
+        carry += static_cast<uint64_t>(a[n - 1]) * m + r[n - 1];
+        r[n - 1] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline uint32_t x86SubMul1(uint32_t * r, const uint32_t * a, size_t n, uint32_t m)
+{
+    uint64_t carry = 0;
+    size_t wordCount = n / 2;
+    if(wordCount > 0)
+    {
+        carry = x86SubMulWords(r, a, wordCount, m);
+    }
+    if(n % 2 != 0)
+    {
+        carry += static_cast<uint64_t>(a[n - 1]) * m;
+        uint32_t v = r[n - 1];
+        r[n - 1] = v - static_cast<uint32_t>(carry);
+        carry = (carry >> 32) + (v < static_cast<uint32_t>(carry));
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+#ifdef BIG_INTEGER_USE_SIMD_KERNELS
+// the simd multiplies split both operands into digits of digitBits bits held in 64 bit lanes and
+// sum every column of the product without carrying (product scanning), then carry once at the end.
+// the column sums only fit in 64 bits while the shorter operand stays below simdMulMaxLimbs;
+// below simdMulMinLimbs the scalar loops are faster
+
+const size_t simdMulMinLimbs = 24, simdMulMaxLimbs = 1024;
+
+inline size_t digitCount(size_t limbCount, unsigned digitBits)
+{
+    return (limbCount * 32 + digitBits - 1) / digitBits;
+}
+
+inline void limbsToDigits(uint64_t * d, size_t count, const uint32_t * a, size_t n, unsigned digitBits)
+{
+    const uint64_t mask = (static_cast<uint64_t>(1) << digitBits) - 1;
+    unsigned __int128 accumulator = 0;
+    unsigned accumulatorBits = 0;
+    size_t i = 0;
+    for(size_t k = 0; k < count; k++)
+    {
+        while(accumulatorBits < digitBits && i < n)
+        {
+            accumulator |= static_cast<unsigned __int128>(a[i++]) << accumulatorBits;
+            accumulatorBits += 32;
+        }
+        d[k] = static_cast<uint64_t>(accumulator) & mask;
+        accumulator >>= digitBits;
+        accumulatorBits = accumulatorBits > digitBits ? accumulatorBits - digitBits : 0;
+    }
+}
+
+// carries the column sums through digitBits bit digits and writes the low rn limbs
+inline void columnsToLimbs(uint32_t * r, size_t rn, const uint64_t * columns, size_t count, unsigned digitBits)
+{
+    const uint64_t mask = (static_cast<uint64_t>(1) << digitBits) - 1;
+    unsigned __int128 accumulator = 0;
+    unsigned accumulatorBits = 0;
+    uint64_t carry = 0;
+    size_t i = 0;
+    for(size_t k = 0; k < count && i < rn; k++)
+    {
+        unsigned __int128 v = static_cast<unsigned __int128>(columns[k]) + carry;
+        carry = static_cast<uint64_t>(v >> digitBits);
+        accumulator |= static_cast<unsigned __int128>(static_cast<uint64_t>(v) & mask) << accumulatorBits;
+        accumulatorBits += digitBits;
+        while(accumulatorBits >= 32 && i < rn)
+        {
+            r[i++] = static_cast<uint32_t>(accumulator);
+            accumulator >>= 32;
+            accumulatorBits -= 32;
+        }
+    }
+    accumulator |= static_cast<unsigned __int128>(carry) << accumulatorBits;
+    while(i < rn)
+    {
+        r[i++] = static_cast<uint32_t>(accumulator);
+        accumulator >>= 32;
+    }
+}
+
+// radix 2^52 with vpmadd52luq / vpmadd52huq, 8 columns per step
+__attribute__((target("avx512f,avx512ifma"))) inline void ifmaMulN(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb, size_t rn)
+{
+    if(na < nb)
+    {
+        swap(a, b);
+        swap(na, nb);
+    }
+    if(nb < simdMulMinLimbs || nb > simdMulMaxLimbs)
+    {
+        schoolbookMulN<x86AddMul1>(r, a, na, b, nb, rn);
+        return;
+    }
+    size_t da = digitCount(na, 52), db = digitCount(nb, 52);
+    size_t dc = min(da + db, digitCount(rn, 52));
+    vector<uint64_t> aDigits(da + 16, 0), bDigits(db), low(dc + 8), high(dc + 8);
+    limbsToDigits(&aDigits[8], da, a, na, 52);
+    limbsToDigits(&bDigits[0], db, b, nb, 52);
+    for(size_t c = 0; c < dc; c += 8)
+    {
+        __m512i lowSum = _mm512_setzero_si512(), highSum = _mm512_setzero_si512();
+        size_t jLast = min(db, c + 8);
+        for(size_t j = c + 1 > da ? c + 1 - da : 0; j < jLast; j++)
+        {
+            __m512i x = _mm512_loadu_si512(&aDigits[8 + c - j]);
+            __m512i y = _mm512_set1_epi64(static_cast<long long>(bDigits[j]));
+            lowSum = _mm512_madd52lo_epu64(lowSum, x, y);
+            highSum = _mm512_madd52hi_epu64(highSum, x, y);
+        }
+        _mm512_storeu_si512(&low[c], lowSum);
+        _mm512_storeu_si512(&high[c], highSum);
+    }
+    for(size_t k = dc - 1; k > 0; k--)
+    {
+        low[k] += high[k - 1];
+    }
+    columnsToLimbs(r, rn, &low[0], dc, 52);
+}
+
+// radix 2^26 with vpmuludq, 4 columns per step
+__attribute__((target("avx2"))) inline void avx2MulN(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb, size_t rn)
+{
+    if(na < nb)
+    {
+        swap(a, b);
+        swap(na, nb);
+    }
+    if(nb < simdMulMinLimbs || nb > simdMulMaxLimbs)
+    {
+        schoolbookMulN<portableAddMul1>(r, a, na, b, nb, rn);
+        return;
+    }
+    size_t da = digitCount(na, 26), db = digitCount(nb, 26);
+    size_t dc = min(da + db, digitCount(rn, 26));
+    vector<uint64_t> aDigits(da + 8, 0), bDigits(db), columns(dc + 4);
+    limbsToDigits(&aDigits[4], da, a, na, 26);
+    limbsToDigits(&bDigits[0], db, b, nb, 26);
+    for(size_t c = 0; c < dc; c += 4)
+    {
+        __m256i sum = _mm256_setzero_si256();
+        size_t jLast = min(db, c + 4);
+        for(size_t j = c + 1 > da ? c + 1 - da : 0; j < jLast; j++)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&aDigits[4 + c - j]));
+            __m256i y = _mm256_set1_epi64x(static_cast<long long>(bDigits[j]));
+            sum = _mm256_add_epi64(sum, _mm256_mul_epu32(x, y));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&columns[c]), sum);
+    }
+    columnsToLimbs(r, rn, &columns[0], dc, 26);
+}
+
+// 4 lanes per step, zero extending the limbs with vpmovzxdq
+__attribute__((target("avx2"))) inline void avx2AddLanes(int64_t * lanes, const uint32_t * a, size_t n, bool negate)
+{
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256i x = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+        __m256i lane = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lanes + i));
+        lane = negate ? _mm256_sub_epi64(lane, x) : _mm256_add_epi64(lane, x);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes + i), lane);
+    }
+    portableAddLanes(lanes + i, a + i, n - i, negate);
+}
+#endif // BIG_INTEGER_USE_SIMD_KERNELS
+
+inline bool cpuHasBmi2Adx()
+{
+    unsigned eax, ebx, ecx, edx;
+    if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    const unsigned bmi2Bit = 1 << 8, adxBit = 1 << 19;
+    return (ebx & bmi2Bit) != 0 && (ebx & adxBit) != 0;
+}
+#endif // BIG_INTEGER_USE_X86_64_KERNELS
+
+inline LimbKernels selectLimbKernels()
+{
+    LimbKernels portable = {portableAddN, portableSubN, portableMul1, portableAddMul1, portableSubMul1, schoolbookMulN<portableAddMul1>, portableAddLanes, 40, "portable"};
+#ifdef BIG_INTEGER_USE_X86_64_KERNELS
+    __builtin_cpu_init();
+    bool hasBmi2Adx = cpuHasBmi2Adx();
+#ifdef BIG_INTEGER_USE_SIMD_KERNELS
+    if(hasBmi2Adx && __builtin_cpu_supports("avx512ifma"))
+    {
+        LimbKernels ifma = {x86AddN, x86SubN, x86Mul1, x86AddMul1, x86SubMul1, ifmaMulN, avx2AddLanes, 512, "x86-64 mulx/adx + avx512 ifma"};
+        return ifma;
+    }
+    if(!hasBmi2Adx && __builtin_cpu_supports("avx2"))
+    {
+        LimbKernels avx2 = {portableAddN, portableSubN, portableMul1, portableAddMul1, portableSubMul1, avx2MulN, avx2AddLanes, 256, "avx2"};
+        return avx2;
+    }
+#endif
+    if(hasBmi2Adx)
+    {
+        LimbKernels x86 = {x86AddN, x86SubN, x86Mul1, x86AddMul1, x86SubMul1, schoolbookMulN<x86AddMul1>, portableAddLanes, 40, "x86-64 mulx/adx"};
+#ifdef BIG_INTEGER_USE_SIMD_KERNELS
+        if(__builtin_cpu_supports("avx2"))
+        {
+            x86.addLanes = avx2AddLanes;
+        }
+#endif
+        return x86;
+    }
+#endif
+    return portable;
+}
+
+// chosen once on first use and shared by every algorithm
+inline const LimbKernels & limbKernels()
+{
+    static const LimbKernels kernels = selectLimbKernels();
+    return kernels;
+}
+
+#endif // BIG_INTEGER_KERNELS_H_INCLUDED
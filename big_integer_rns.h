@@ -0,0 +1,169 @@
+#ifndef BIG_INTEGER_RNS_H_INCLUDED
+#define BIG_INTEGER_RNS_H_INCLUDED
+
+#include "big_integer_crt.h"
+
+// residue number system : a value is kept as its residues modulo a basis of pairwise coprime moduli, so + - and *
+// work on every lane on its own with no carries between them. the result is only right modulo the product of the
+// basis, so the basis must be picked for the largest value the computation reaches; rnsPrimes gives one for a bit size.
+// values convert in through a remainder tree and out through the chinese remainder reconstruction of the basis.
+//
+//     CRTContext basis(rnsPrimes(4096));
+//     RNSInteger x(basis, a);
+//     for(...) x *= RNSInteger(basis, b);
+//     BigInteger v = x.toBigInteger();
+
+// the largest primes below 2^62, as many as it takes for the product to hold signed values of up to bits bits
+inline const vector<uint64_t> rnsPrimes(size_t bits)
+{
+    vector<uint64_t> retval;
+    uint64_t candidate = (static_cast<uint64_t>(1) << 62) - 1;
+    // every prime found is above 2^61, so each one adds more than 61 bits to the product
+    for(size_t productBits = 0; productBits <= bits; candidate -= 2)
+    {
+        if(isProbablePrime(BigInteger(static_cast<int64_t>(candidate))))
+        {
+            retval.push_back(candidate);
+            productBits += 61;
+        }
+    }
+    return retval;
+}
+
+class RNSInteger
+{
+private:
+    const CRTContext * basis;
+    vector<uint64_t> residues;
+    // lanes are handed to the threads in blocks this big, so small bases never start threads
+    static const size_t laneBlock = 4096;
+
+    void checkBasis(const RNSInteger & r) const
+    {
+        if(basis != r.basis)
+        {
+            throw new domain_error("RNSInteger operands must use the same basis");
+        }
+    }
+
+    // residues[i] = op(residues[i], r.residues[i], i) for every lane
+    template <typename Op>
+    void forEachLane(const RNSInteger & r, const Op & op)
+    {
+        checkBasis(r);
+        size_t count = residues.size();
+        uint64_t * a = residues.data();
+        const uint64_t * b = r.residues.data();
+        batchForEach((count + laneBlock - 1) / laneBlock, basis->isParallel(), [a, b, count, &op](size_t block)
+        {
+            size_t end = min(count, (block + 1) * laneBlock);
+            for(size_t i = block * laneBlock; i < end; i++)
+            {
+                a[i] = op(a[i], b[i], i);
+            }
+        });
+    }
+
+public:
+    // zero in basis; the basis must outlive the value and its moduli must be below 2^63 so a sum of two residues
+    // fits in a word
+    explicit RNSInteger(const CRTContext & basis)
+        : basis(&basis), residues(basis.getModuli().size(), 0)
+    {
+        const vector<uint64_t> & moduli = basis.getModuli();
+        for(size_t i = 0; i < moduli.size(); i++)
+        {
+            if(moduli[i] >> 63 != 0)
+            {
+                throw new domain_error("the moduli of an RNSInteger basis must be below 2^63");
+            }
+        }
+    }
+
+    RNSInteger(const CRTContext & basis, const BigInteger & v)
+        : RNSInteger(basis)
+    {
+        residues = basis.residues(v);
+    }
+
+    const CRTContext & getBasis() const
+    {
+        return *basis;
+    }
+
+    const vector<uint64_t> & getResidues() const
+    {
+        return residues;
+    }
+
+    // the value in (-M / 2, M / 2], or in [0, M) if isSigned is not set, where M is the product of the basis
+    const BigInteger toBigInteger(bool isSigned = true) const
+    {
+        return basis->reconstruct(residues, isSigned);
+    }
+
+    const RNSInteger & operator +=(const RNSInteger & r)
+    {
+        const uint64_t * m = basis->getModuli().data();
+        forEachLane(r, [m](uint64_t a, uint64_t b, size_t i)
+        {
+            uint64_t sum = a + b;
+            return sum >= m[i] ? sum - m[i] : sum;
+        });
+        return *this;
+    }
+
+    const RNSInteger & operator -=(const RNSInteger & r)
+    {
+        const uint64_t * m = basis->getModuli().data();
+        forEachLane(r, [m](uint64_t a, uint64_t b, size_t i)
+        {
+            uint64_t difference = a - b;
+            return a < b ? difference + m[i] : difference;
+        });
+        return *this;
+    }
+
+    const RNSInteger & operator *=(const RNSInteger & r)
+    {
+        const CRTContext & context = *basis;
+        forEachLane(r, [&context](uint64_t a, uint64_t b, size_t i)
+        {
+            return context.getDivisor(i).mulMod(a, b);
+        });
+        return *this;
+    }
+
+    friend const RNSInteger operator +(RNSInteger l, const RNSInteger & r)
+    {
+        return l += r;
+    }
+
+    friend const RNSInteger operator -(RNSInteger l, const RNSInteger & r)
+    {
+        return l -= r;
+    }
+
+    friend const RNSInteger operator *(RNSInteger l, const RNSInteger & r)
+    {
+        return l *= r;
+    }
+
+    const RNSInteger operator -() const
+    {
+        return RNSInteger(*basis) -= *this;
+    }
+
+    friend bool operator ==(const RNSInteger & l, const RNSInteger & r)
+    {
+        l.checkBasis(r);
+        return l.residues == r.residues;
+    }
+
+    friend bool operator !=(const RNSInteger & l, const RNSInteger & r)
+    {
+        return !(l == r);
+    }
+};
+
+#endif // BIG_INTEGER_RNS_H_INCLUDED
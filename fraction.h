@@ -10,10 +10,10 @@ private:
     void normalize()
     {
         BigInteger divisor = gcd(n, d);
-        if(divisor > BigInteger("1"))
+        if(divisor > 1)
         {
-            n /= divisor;
-            d /= divisor;
+            n = n.divExact(divisor);
+            d = d.divExact(divisor);
         }
         if(d.sign() < 0)
         {
@@ -59,7 +59,7 @@ public:
     }
     friend ostream & operator <<(ostream & os, Fraction v)
     {
-        if(v.d == BigInteger(1))
+        if(v.d == 1)
         {
             return os << v.n;
         }
@@ -67,27 +67,35 @@ public:
     }
     friend Fraction operator +(Fraction a, Fraction b)
     {
-        return Fraction(a.n * b.d + b.n * a.d, a.d * b.d);
+        BigInteger n = a.n * b.d;
+        n.addMul(b.n, a.d);
+        return Fraction(n, a.d * b.d);
     }
     friend Fraction operator +(BigInteger a, Fraction b)
     {
-        return Fraction(a * b.d + b.n, b.d);
+        a.mulAdd(b.d, b.n);
+        return Fraction(a, b.d);
     }
     friend Fraction operator +(Fraction a, BigInteger b)
     {
-        return Fraction(a.n + b * a.d, a.d);
+        a.n.addMul(b, a.d);
+        return Fraction(a.n, a.d);
     }
     friend Fraction operator -(Fraction a, Fraction b)
     {
-        return Fraction(a.n * b.d - b.n * a.d, a.d * b.d);
+        BigInteger n = a.n * b.d;
+        n.subMul(b.n, a.d);
+        return Fraction(n, a.d * b.d);
     }
     friend Fraction operator -(BigInteger a, Fraction b)
     {
-        return Fraction(a * b.d - b.n, b.d);
+        a.mulAdd(b.d, -b.n);
+        return Fraction(a, b.d);
     }
     friend Fraction operator -(Fraction a, BigInteger b)
     {
-        return Fraction(a.n - b * a.d, a.d);
+        a.n.subMul(b, a.d);
+        return Fraction(a.n, a.d);
     }
     friend Fraction operator *(Fraction a, Fraction b)
     {
@@ -196,6 +204,29 @@ public:
         v.normalize();
         return is;
     }
+    ostream & writeBinary(ostream & os) const
+    {
+        n.writeBinary(os);
+        return d.writeBinary(os);
+    }
+    istream & readBinary(istream & is)
+    {
+        BigInteger numerator, denominator;
+        numerator.readBinary(is);
+        denominator.readBinary(is);
+        if(!is)
+        {
+            return is;
+        }
+        if(denominator.sign() <= 0)
+        {
+            is.setstate(istream::failbit);
+            return is;
+        }
+        n = numerator;
+        d = denominator;
+        return is;
+    }
     friend Fraction operator %(Fraction a, Fraction b)
     {
         if(b.n.isZero())
@@ -246,18 +277,16 @@ public:
             return Fraction(1) / pow(base, -exponent);
         }
         Fraction retval = base;
-        if((exponent & BigInteger(1)).isZero())
+        if(!exponent.testBit(0))
         {
             retval = Fraction(1);
         }
-        exponent &= ~BigInteger(1);
-        for(BigInteger v = BigInteger(2); !exponent.isZero(); v <<= 1)
+        for(size_t i = 1, bitLength = exponent.bitLength(); i < bitLength; i++)
         {
             base.n *= base.n;
             base.d *= base.d;
-            if(!(exponent & v).isZero())
+            if(exponent.testBit(i))
             {
-                exponent &= ~v;
                 retval.n *= base.n;
                 retval.d *= base.d;
             }
@@ -308,18 +337,16 @@ public:
         }
         base %= modulus;
         Fraction retval = base;
-        if((exponent & BigInteger(1)).isZero())
+        if(!exponent.testBit(0))
         {
             retval = Fraction(1);
         }
-        exponent &= ~BigInteger(1);
-        for(BigInteger v = BigInteger(2); !exponent.isZero(); v <<= 1)
+        for(size_t i = 1, bitLength = exponent.bitLength(); i < bitLength; i++)
         {
             base *= base;
             base %= modulus;
-            if(!(exponent & v).isZero())
+            if(exponent.testBit(i))
             {
-                exponent &= ~v;
                 retval *= base;
                 retval %= modulus;
             }
@@ -336,22 +363,13 @@ public:
         Fraction adjustedFraction = f * denominator + Fraction(BigInteger(1), BigInteger(2));
         return Fraction(floor(adjustedFraction), denominator);
     }
-    friend BigInteger ceil(Fraction v)
+    friend BigInteger ceil(const Fraction & v)
     {
-        if(v.sign() < 0)
-        {
-            return -floor(-v);
-        }
-        v.n += v.d - BigInteger(1);
-        return v.n / v.d;
+        return divMod(v.n, v.d, Rounding::Ceiling).first;
     }
-    friend BigInteger floor(Fraction v)
+    friend BigInteger floor(const Fraction & v)
     {
-        if(v.sign() < 0)
-        {
-            return -ceil(-v);
-        }
-        return v.n / v.d;
+        return divMod(v.n, v.d, Rounding::Floor).first;
     }
     const BigInteger & getNumerator() const
     {
@@ -368,7 +386,7 @@ public:
     }
     string getDecimal(size_t fractionalDigits = 15) const
     {
-        BigInteger pow10 = pow(BigInteger("10"), fractionalDigits);
+        BigInteger pow10 = pow(BigInteger(10), fractionalDigits);
         Fraction f = setDenominator(*this, pow10);
         bool isNegative = (f.sign() < 0);
         f = abs(f);
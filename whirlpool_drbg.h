@@ -0,0 +1,148 @@
+#ifndef WHIRLPOOL_DRBG_H_INCLUDED
+#define WHIRLPOOL_DRBG_H_INCLUDED
+
+#include "big_integer.h"
+#include "whirlpool.h"
+#include <ctime>
+
+// a hash drbg after NIST SP 800-90A built on whirlpool, with the 512 bit digest as the seed length.
+// it is seeded from the random device once, reseeded from it every reseedInterval requests and otherwise only hashes,
+// so a secure 2048 bit number costs a few whirlpool blocks instead of a random device read per word.
+// install it as the secure source of BigInteger::random, randomBelow and makeProbablePrime with
+// useWhirlpoolSecureRandom(); every thread then gets its own generator.
+class WhirlpoolDRBG
+{
+private:
+    unsigned char v[DIGESTBYTES];
+    unsigned char c[DIGESTBYTES];
+    size_t requestsSinceReseed;
+    static const size_t reseedInterval = static_cast<size_t>(1) << 16;
+    static const size_t entropyWords = DIGESTBYTES / sizeof(uint32_t);
+
+    // the hash derivation function for a single digest of output
+    static void derive(const string & material, unsigned char (&output)[DIGESTBYTES])
+    {
+        const unsigned char header[5] = {1, 0, 0, DIGESTBITS >> 8, DIGESTBITS & 0xFF};
+        Whirlpool hash;
+        hash.add(header, sizeof(header));
+        hash.add(material);
+        memcpy(output, hash.close().data(), DIGESTBYTES);
+    }
+
+    static const string bytes(const unsigned char (&value)[DIGESTBYTES])
+    {
+        return string(reinterpret_cast<const char *>(value), DIGESTBYTES);
+    }
+
+    // value += addend, both big endian
+    static void add(unsigned char (&value)[DIGESTBYTES], const unsigned char * addend, size_t addendLength)
+    {
+        unsigned carry = 0;
+        for(size_t i = 0; i < DIGESTBYTES; i++)
+        {
+            unsigned sum = value[DIGESTBYTES - 1 - i] + carry;
+            if(i < addendLength)
+            {
+                sum += addend[addendLength - 1 - i];
+            }
+            value[DIGESTBYTES - 1 - i] = static_cast<unsigned char>(sum);
+            carry = sum >> 8;
+        }
+    }
+
+    static const string entropy()
+    {
+        string retval;
+        try
+        {
+            random_device device;
+            for(size_t i = 0; i < entropyWords; i++)
+            {
+                uint32_t word = device();
+                retval.append(reinterpret_cast<const char *>(&word), sizeof(word));
+            }
+        }
+        catch(exception & e)
+        {
+            throw new runtime_error("no random device to seed the whirlpool drbg from");
+        }
+        return retval;
+    }
+
+    void setSeed(const unsigned char (&seed)[DIGESTBYTES])
+    {
+        memcpy(v, seed, DIGESTBYTES);
+        derive(string(1, '\0') + bytes(v), c);
+        requestsSinceReseed = 0;
+    }
+
+    WhirlpoolDRBG(const WhirlpoolDRBG &);
+    const WhirlpoolDRBG & operator =(const WhirlpoolDRBG &);
+public:
+    // seeds from the random device, with the time and the address of the generator as the nonce
+    WhirlpoolDRBG()
+    {
+        uint64_t nonce[2] = {static_cast<uint64_t>(time(NULL)), static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this))};
+        unsigned char seed[DIGESTBYTES];
+        derive(entropy() + string(reinterpret_cast<const char *>(nonce), sizeof(nonce)), seed);
+        setSeed(seed);
+    }
+
+    // mixes fresh random device output into the state
+    void reseed()
+    {
+        unsigned char seed[DIGESTBYTES];
+        derive(string(1, '\1') + bytes(v) + entropy(), seed);
+        setSeed(seed);
+    }
+
+    // fills output with length random bytes, hashing the state and its successors one 64 byte block at a time,
+    // then moves the state on so earlier output can't be recovered from it
+    void generate(unsigned char * output, size_t length)
+    {
+        if(requestsSinceReseed >= reseedInterval)
+        {
+            reseed();
+        }
+        unsigned char data[DIGESTBYTES];
+        memcpy(data, v, DIGESTBYTES);
+        const unsigned char one = 1;
+        for(size_t i = 0; i < length; i += DIGESTBYTES)
+        {
+            Whirlpool hash;
+            hash.add(data, DIGESTBYTES);
+            string block = hash.close();
+            memcpy(output + i, block.data(), min<size_t>(DIGESTBYTES, length - i));
+            add(data, &one, 1);
+        }
+        unsigned char h[DIGESTBYTES];
+        Whirlpool hash;
+        hash.add(static_cast<unsigned char>(3));
+        hash.add(v, DIGESTBYTES);
+        memcpy(h, hash.close().data(), DIGESTBYTES);
+        requestsSinceReseed++;
+        unsigned char counter[sizeof(uint64_t)];
+        for(size_t i = 0; i < sizeof(counter); i++)
+        {
+            counter[i] = static_cast<unsigned char>(static_cast<uint64_t>(requestsSinceReseed) >> (8 * (sizeof(counter) - 1 - i)));
+        }
+        add(v, h, DIGESTBYTES);
+        add(v, c, DIGESTBYTES);
+        add(v, counter, sizeof(counter));
+    }
+};
+
+// a SecureRandomSource reading the whirlpool drbg of the calling thread
+inline void whirlpoolRandomLimbs(uint32_t * limbs, size_t count)
+{
+    thread_local WhirlpoolDRBG generator;
+    generator.generate(reinterpret_cast<unsigned char *>(limbs), count * sizeof(uint32_t));
+}
+
+// makes the whirlpool drbg the secure source of the random numbers; call it before starting other threads
+inline void useWhirlpoolSecureRandom()
+{
+    secureRandomSource() = whirlpoolRandomLimbs;
+}
+
+#endif // WHIRLPOOL_DRBG_H_INCLUDED